@@ -1,14 +1,26 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+// float vertices provide vec3 positions, w defaults to 1. quantized vertices provide snorm16 positions with w = 0,
+// an octahedral encoded normal in aNormal.xy and half float uvs. uMat includes the position dequantization
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
 uniform mat4 uMat;
 
 out vec2 oTexCoord;
+out vec3 oNormal;
+
+vec3 oct_decode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
 
 void main()
 {						
 	oTexCoord = aTexCoord;
-	gl_Position = uMat * vec4(aPos, 1.0);
+	oNormal = aPos.w == 0.0 ? oct_decode(aNormal.xy) : aNormal;
+	gl_Position = uMat * vec4(aPos.xyz, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 330 core
+// instanced variant of pbr_vertex.glsl, the model matrix of every instance comes from the instance buffer and
+// includes the position dequantization
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 4) in mat4 aInstanceMatrix;
+
+uniform mat4 uViewProjection;
+
+out vec2 oTexCoord;
+out vec3 oNormal;
+
+vec3 oct_decode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
+
+void main()
+{						
+	oTexCoord = aTexCoord;
+	oNormal = aPos.w == 0.0 ? oct_decode(aNormal.xy) : aNormal;
+	gl_Position = uViewProjection * aInstanceMatrix * vec4(aPos.xyz, 1.0);
+}
\ No newline at end of file
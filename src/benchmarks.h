@@ -0,0 +1,309 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "mesh_builder.h"
+#include "simd_kernels.h"
+#include "vertex_stream.h"
+
+// cpu benchmarks on synthetic data and the bundled meshes, run with --benchmark instead of opening the renderer
+namespace Benchmarks {
+
+	// results are written here so the measured loops aren't optimized away
+	volatile float sink{};
+
+	// the rotation keeps the products from degenerating over deep chains
+	glm::mat4 get_node_transform(uint32_t node, float time) {
+		return glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.01f, 0.0f, 0.0f)), 0.001f * (float)(node % 7) + time, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+	// num_chains chains of depth nodes below the root, one mesh per node
+	std::unique_ptr<MeshBuilder::NodeStorage> make_deep_hierarchy(uint32_t num_chains, uint32_t depth, const std::shared_ptr<MeshBuilder::Mesh>& mesh) {
+		const uint32_t num_nodes = 1 + num_chains * depth;
+		auto nodes = std::make_unique<MeshBuilder::NodeStorage>(MeshBuilder::NodeStorageSize{ num_nodes, num_nodes, num_nodes });
+		nodes->append_node(MeshBuilder::no_node, "r", glm::mat4(1.0f));
+		// breadth first: the level above is always the previous num_chains nodes
+		for (uint32_t node = 1; node < num_nodes; node++) {
+			const uint32_t parent = node <= num_chains ? 0 : node - num_chains;
+			nodes->append_node(parent, "n", get_node_transform(node, 0.0f));
+			nodes->append_mesh(mesh);
+		}
+		nodes->update_transforms();
+		return nodes;
+	}
+	// every node gets up to max_children children until num_nodes are reached, appended breadth first. the last node
+	// so far always gets one, so the tree can't die out
+	std::unique_ptr<MeshBuilder::NodeStorage> make_random_hierarchy(uint32_t num_nodes, uint32_t max_children, const std::shared_ptr<MeshBuilder::Mesh>& mesh, std::mt19937& random) {
+		auto nodes = std::make_unique<MeshBuilder::NodeStorage>(MeshBuilder::NodeStorageSize{ num_nodes, num_nodes, num_nodes });
+		nodes->append_node(MeshBuilder::no_node, "r", glm::mat4(1.0f));
+		for (uint32_t parent = 0; parent < nodes->size() && nodes->size() < num_nodes; parent++) {
+			const uint32_t num_children = std::min((uint32_t)(random() % (max_children + 1)) + (parent + 1 == nodes->size()), num_nodes - (uint32_t)nodes->size());
+			for (uint32_t i = 0; i < num_children; i++) {
+				nodes->append_node(parent, "n", get_node_transform((uint32_t)random(), (float)(random() % 100)));
+				nodes->append_mesh(mesh);
+			}
+		}
+		return nodes;
+	}
+	template <typename Frame>
+	double measure_frame_ms(size_t num_frames, Frame&& frame) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < num_frames; i++) {
+			frame(i);
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / num_frames;
+	}
+
+	// a frame animates every chain's top node and reads every mesh's world matrix like draw_mesh does. uncached walks
+	// to the root per mesh, cached runs update_transforms once and reads the cache
+	void run_transform_benchmark(std::ostream& out = std::cout) {
+		constexpr uint32_t num_nodes = 1 << 16;
+		constexpr size_t num_frames = 20;
+		auto mesh = std::make_shared<MeshBuilder::Mesh>();
+		out << "transforms: " << num_nodes << " nodes, ms per frame\n";
+		out << "  depth   uncached    cached\n";
+		for (uint32_t depth = 1; depth <= 1024; depth *= 4) {
+			const uint32_t num_chains = num_nodes / depth;
+			auto nodes = make_deep_hierarchy(num_chains, depth, mesh);
+			float checksum{};
+			const double uncached_ms = measure_frame_ms(num_frames, [&](size_t frame) {
+				for (uint32_t node = 1; node <= num_chains; node++) {
+					nodes->set_transform(node, get_node_transform(node, (float)frame));
+				}
+				for (uint32_t node = 0; node < nodes->size(); node++) {
+					checksum += nodes->compute_global_transform(node)[3][0];
+				}
+				nodes->update_transforms(); // keeps the flags from piling up, not part of the old frame
+			});
+			const double cached_ms = measure_frame_ms(num_frames, [&](size_t frame) {
+				for (uint32_t node = 1; node <= num_chains; node++) {
+					nodes->set_transform(node, get_node_transform(node, (float)frame));
+				}
+				nodes->update_transforms();
+				for (uint32_t node = 0; node < nodes->size(); node++) {
+					checksum += nodes->get_global_transform(node)[3][0];
+				}
+			});
+			out << "  " << std::setw(5) << depth << std::fixed << std::setprecision(3) << std::setw(11) << uncached_ms << std::setw(10) << cached_ms << "\n";
+			sink = checksum;
+		}
+	}
+
+	// the parallel update has to match the serial one bit for bit, also after partial updates. the uncached walk
+	// associates the products the other way round, so it only matches up to rounding
+	bool check_transform_determinism(std::ostream& out = std::cout) {
+		constexpr uint32_t num_nodes = 100000;
+		auto mesh = std::make_shared<MeshBuilder::Mesh>();
+		std::mt19937 serial_random{ 7 };
+		std::mt19937 parallel_random{ 7 };
+		auto serial = make_random_hierarchy(num_nodes, 4, mesh, serial_random);
+		auto parallel = make_random_hierarchy(num_nodes, 4, mesh, parallel_random);
+		bool is_identical = true;
+		float max_walk_error{};
+		std::mt19937 random{ 11 };
+		for (int frame = 0; frame < 4; frame++) {
+			serial->update_transforms(false);
+			parallel->update_transforms(true);
+			for (uint32_t node = 0; node < num_nodes; node++) {
+				const glm::mat4& global_transform = parallel->get_global_transform(node);
+				is_identical &= std::memcmp(&global_transform, &serial->get_global_transform(node), sizeof(glm::mat4)) == 0;
+				const glm::mat4 walked = parallel->compute_global_transform(node);
+				for (int j = 0; j < 4; j++) {
+					for (int k = 0; k < 4; k++) {
+						max_walk_error = std::max(max_walk_error, std::abs(global_transform[j][k] - walked[j][k]) / std::max(1.0f, std::abs(walked[j][k])));
+					}
+				}
+			}
+			// animate a random subset for the next frame
+			for (uint32_t i = 0; i < num_nodes / 100; i++) {
+				const uint32_t node = random() % num_nodes;
+				const glm::mat4 transform = get_node_transform(node, (float)frame);
+				serial->set_transform(node, transform);
+				parallel->set_transform(node, transform);
+			}
+		}
+		const bool is_ok = is_identical && max_walk_error < 1e-3f;
+		out << "transform determinism: parallel " << (is_identical ? "matches" : "differs from") << " serial, max relative difference to the uncached walk " << std::scientific << max_walk_error << std::defaultfloat << (is_ok ? ", ok\n" : ", FAILED\n");
+		return is_ok;
+	}
+	// every chain top is animated, so every node is recomputed each frame
+	void run_parallel_transform_benchmark(std::ostream& out = std::cout) {
+		constexpr uint32_t num_chains = 1 << 14;
+		constexpr uint32_t depth = 16;
+		constexpr size_t num_frames = 20;
+		auto mesh = std::make_shared<MeshBuilder::Mesh>();
+		auto nodes = make_deep_hierarchy(num_chains, depth, mesh);
+		double frame_ms[2]{};
+		for (int parallel = 0; parallel < 2; parallel++) {
+			frame_ms[parallel] = measure_frame_ms(num_frames, [&](size_t frame) {
+				for (uint32_t node = 1; node <= num_chains; node++) {
+					nodes->set_transform(node, get_node_transform(node, (float)frame));
+				}
+				nodes->update_transforms(parallel != 0);
+			});
+		}
+		out << "transform update: " << nodes->size() << " animated nodes, serial " << frame_ms[0] << " ms, parallel " << frame_ms[1] << " ms on " << ThreadPool::get().get_num_threads() << " threads\n";
+	}
+
+	// every kernel on every level the cpu supports, in ns per item. the results are compared with the scalar ones
+	bool run_kernel_benchmark(std::ostream& out = std::cout) {
+		constexpr size_t count = 1 << 14;
+		constexpr size_t num_runs = 50;
+		constexpr size_t point_stride = 8; // position, normal and uv
+		std::mt19937 random{ 3 };
+		std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+		std::vector<glm::mat4> matrices(count);
+		std::vector<aiMatrix4x4> ai_matrices(count);
+		for (size_t i = 0; i < count; i++) {
+			for (int e = 0; e < 16; e++) {
+				reinterpret_cast<float*>(&matrices[i])[e] = value(random);
+				reinterpret_cast<float*>(&ai_matrices[i])[e] = value(random);
+			}
+		}
+		std::vector<float> points(count * point_stride);
+		for (auto& p : points) {
+			p = value(random);
+		}
+		std::vector<Bounds::AABB> aabbs(count);
+		std::vector<glm::vec4> spheres(count);
+		for (size_t i = 0; i < count; i++) {
+			const glm::vec3 center(value(random), value(random), value(random));
+			const glm::vec3 extent(std::abs(value(random)), std::abs(value(random)), std::abs(value(random)));
+			// some empty boxes, which have to pass through
+			aabbs[i] = i % 16 == 0 ? Bounds::AABB{} : Bounds::AABB{ center - extent, center + extent };
+			spheres[i] = glm::vec4(center * 4.0f, std::abs(value(random)));
+		}
+		Bounds::Frustum planes{};
+		for (auto& plane : planes) {
+			const glm::vec3 normal(value(random), value(random), value(random));
+			plane = glm::vec4(normal / glm::length(normal), value(random) * 4.0f);
+		}
+		// close to orthonormal, so the repeated in place point transforms stay finite
+		const glm::mat4 transform = get_node_transform(3, 1.0f);
+
+		struct Results {
+			std::vector<glm::mat4> products{};
+			std::vector<float> points{};
+			std::vector<Bounds::AABB> aabbs{};
+			std::vector<uint8_t> outside{};
+			std::vector<glm::mat4> converted{};
+		};
+		auto run_once = [&](const SimdKernels::Kernels& kernels) {
+			Results results{ std::vector<glm::mat4>(count), points, std::vector<Bounds::AABB>(count), std::vector<uint8_t>(count), std::vector<glm::mat4>(count) };
+			kernels.multiply(matrices.data(), transform, results.products.data(), count);
+			kernels.transform_points(transform, results.points.data(), count, point_stride);
+			kernels.transform_aabbs(transform, aabbs.data(), results.aabbs.data(), count);
+			kernels.cull_spheres(planes, &spheres[0].x, count, 4, results.outside.data());
+			kernels.convert_ai_matrices(ai_matrices.data(), results.converted.data(), count);
+			return results;
+		};
+		auto is_same = [](const auto& a, const auto& b) {
+			return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+		};
+		const Results reference = run_once(SimdKernels::get_kernels(SimdKernels::Level::scalar));
+		bool is_ok = true;
+
+		out << "simd kernels: " << count << " items, ns per item, using " << SimdKernels::get_level_name(SimdKernels::get_kernels().level) << "\n";
+		out << "  level   multiply  points   aabbs  spheres  ai matrices\n";
+		for (auto level : { SimdKernels::Level::scalar, SimdKernels::Level::sse41, SimdKernels::Level::avx2, SimdKernels::Level::neon }) {
+			if (!SimdKernels::is_supported(level)) {
+				continue;
+			}
+			const auto& kernels = SimdKernels::get_kernels(level);
+			Results results = run_once(kernels);
+			std::string differences{};
+			differences += is_same(results.products, reference.products) ? "" : " multiply";
+			differences += is_same(results.points, reference.points) ? "" : " points";
+			differences += is_same(results.aabbs, reference.aabbs) ? "" : " aabbs";
+			differences += is_same(results.outside, reference.outside) ? "" : " spheres";
+			differences += is_same(results.converted, reference.converted) ? "" : " ai_matrices";
+			is_ok &= differences.empty();
+			const double ns_per_ms = 1e6 / count;
+			const double multiply_ns = ns_per_ms * measure_frame_ms(num_runs, [&](size_t) { kernels.multiply(matrices.data(), transform, results.products.data(), count); });
+			const double points_ns = ns_per_ms * measure_frame_ms(num_runs, [&](size_t) { kernels.transform_points(transform, results.points.data(), count, point_stride); });
+			const double aabbs_ns = ns_per_ms * measure_frame_ms(num_runs, [&](size_t) { kernels.transform_aabbs(transform, aabbs.data(), results.aabbs.data(), count); });
+			const double spheres_ns = ns_per_ms * measure_frame_ms(num_runs, [&](size_t) { kernels.cull_spheres(planes, &spheres[0].x, count, 4, results.outside.data()); });
+			const double convert_ns = ns_per_ms * measure_frame_ms(num_runs, [&](size_t) { kernels.convert_ai_matrices(ai_matrices.data(), results.converted.data(), count); });
+			sink = results.points[0];
+			out << "  " << std::left << std::setw(7) << SimdKernels::get_level_name(level) << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(9) << multiply_ns << std::setw(8) << points_ns << std::setw(8) << aabbs_ns << std::setw(9) << spheres_ns << std::setw(13) << convert_ns
+				<< (differences.empty() ? "  matches scalar" : "  differs from scalar:" + differences) << "\n";
+		}
+		return is_ok;
+	}
+
+	// the vertex stream kernels against their scalar fallbacks on every mesh of a bundled model, in vertices per
+	// second. the kernels only move floats around, so their output has to match the scalar one exactly
+	bool run_vertex_stream_benchmark(const std::string& asset_dir, std::ostream& out = std::cout) {
+		constexpr size_t num_runs = 50;
+		bool is_ok = true;
+		out << "vertex streams: million vertices per second, scalar vs " << VertexStream::get_kernel_name() << "\n";
+		out << "  mesh                          vertices  interleaved scalar  interleaved simd\n";
+		for (const char* mesh_path : { "meshes/teapot/teapot.gltf", "meshes/candle/brass_candleholders_1k.gltf" }) {
+			Assimp::Importer assimp_importer{};
+			const aiScene* assimp_scene = assimp_importer.ReadFile((asset_dir + mesh_path).c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
+			if (!assimp_scene) {
+				out << "  " << mesh_path << ": " << assimp_importer.GetErrorString() << "\n";
+				is_ok = false;
+				continue;
+			}
+			// the layouts the import path interleaves, position and normal with and without the first uv channel
+			std::vector<const aiMesh*> ai_meshes{};
+			size_t num_vertices{};
+			for (unsigned int i = 0; i < assimp_scene->mNumMeshes; i++) {
+				const aiMesh* ai_mesh = assimp_scene->mMeshes[i];
+				if (ai_mesh->mVertices && ai_mesh->mNormals) {
+					ai_meshes.push_back(ai_mesh);
+					num_vertices += ai_mesh->mNumVertices;
+				}
+			}
+			auto interleave = [&](bool use_simd, std::vector<float>& vertices) {
+				const VertexStream::Kernels& kernels = use_simd ? VertexStream::get_kernels() : VertexStream::get_kernels(SimdKernels::Level::scalar);
+				float* vertex = vertices.data();
+				for (const aiMesh* ai_mesh : ai_meshes) {
+					const aiVector3D* uvs = ai_mesh->mTextureCoords[0];
+					if (uvs) {
+						kernels.interleave_position_normal_uv(ai_mesh->mVertices, ai_mesh->mNormals, uvs, ai_mesh->mNumVertices, vertex);
+					}
+					else {
+						kernels.interleave_position_normal(ai_mesh->mVertices, ai_mesh->mNormals, ai_mesh->mNumVertices, vertex);
+					}
+					vertex += ai_mesh->mNumVertices * (uvs ? 8 : 6);
+				}
+			};
+			double vertices_per_second[2]{};
+			std::vector<float> vertices[2]{ std::vector<float>(num_vertices * 8), std::vector<float>(num_vertices * 8) };
+			for (int use_simd = 0; use_simd < 2; use_simd++) {
+				const double interleave_ms = measure_frame_ms(num_runs, [&](size_t) { interleave(use_simd != 0, vertices[use_simd]); });
+				vertices_per_second[use_simd] = num_vertices / (interleave_ms * 1e-3);
+				sink = vertices[use_simd][0];
+			}
+			const bool is_same = vertices[0] == vertices[1];
+			is_ok &= is_same;
+			out << "  " << std::left << std::setw(28) << std::filesystem::path(mesh_path).filename().string() << std::right << std::setw(10) << num_vertices << std::fixed << std::setprecision(1)
+				<< std::setw(20) << vertices_per_second[0] * 1e-6 << std::setw(18) << vertices_per_second[1] * 1e-6
+				<< (is_same ? "  matches scalar" : "  differs from scalar") << std::defaultfloat << "\n";
+		}
+		return is_ok;
+	}
+
+	// false when any of the checks failed, the benchmarks still all run
+	bool run(const std::string& asset_dir, std::ostream& out = std::cout) {
+		bool is_ok = run_vertex_stream_benchmark(asset_dir, out);
+		is_ok &= run_kernel_benchmark(out);
+		is_ok &= check_transform_determinism(out);
+		run_transform_benchmark(out);
+		run_parallel_transform_benchmark(out);
+		return is_ok;
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOUNDS_SSE2
+#endif
+
+// bounding volumes and the culling tests on them
+namespace Bounds {
+
+	struct AABB {
+		glm::vec3 min{ std::numeric_limits<float>::max() };
+		glm::vec3 max{ std::numeric_limits<float>::lowest() };
+
+		bool is_empty() const {
+			return min.x > max.x;
+		}
+		glm::vec3 get_center() const {
+			return (min + max) * 0.5f;
+		}
+		glm::vec3 get_extent() const {
+			return (max - min) * 0.5f;
+		}
+		void expand(const glm::vec3& p) {
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		void expand(const AABB& rhs) {
+			min = glm::min(min, rhs.min);
+			max = glm::max(max, rhs.max);
+		}
+	};
+
+	struct BoundingSphere {
+		glm::vec3 center{};
+		float radius{};
+	};
+
+	// bounds of the first three floats of every vertex
+	AABB compute_aabb_scalar(const float* vertices, size_t num_vertices, size_t vertex_stride) {
+		AABB aabb{};
+		for (size_t i = 0; i < num_vertices; i++) {
+			const float* p = vertices + i * vertex_stride;
+			aabb.expand(glm::vec3(p[0], p[1], p[2]));
+		}
+		return aabb;
+	}
+	AABB compute_aabb(const float* vertices, size_t num_vertices, size_t vertex_stride) {
+#if defined(BOUNDS_SSE2)
+		if (num_vertices < 2) {
+			return compute_aabb_scalar(vertices, num_vertices, vertex_stride);
+		}
+		// the 4 float loads read one float past the position, so the last vertex goes through the scalar path
+		__m128 min_xyz = _mm_loadu_ps(vertices);
+		__m128 max_xyz = min_xyz;
+		for (size_t i = 1; i + 1 < num_vertices; i++) {
+			const __m128 p = _mm_loadu_ps(vertices + i * vertex_stride);
+			min_xyz = _mm_min_ps(min_xyz, p);
+			max_xyz = _mm_max_ps(max_xyz, p);
+		}
+		alignas(16) float min_out[4];
+		alignas(16) float max_out[4];
+		_mm_store_ps(min_out, min_xyz);
+		_mm_store_ps(max_out, max_xyz);
+		AABB aabb{ glm::vec3(min_out[0], min_out[1], min_out[2]), glm::vec3(max_out[0], max_out[1], max_out[2]) };
+		const float* last = vertices + (num_vertices - 1) * vertex_stride;
+		aabb.expand(glm::vec3(last[0], last[1], last[2]));
+		return aabb;
+#else
+		return compute_aabb_scalar(vertices, num_vertices, vertex_stride);
+#endif
+	}
+
+	// centered on the box, with the radius of the farthest vertex. tighter than the box's circumscribed sphere
+	BoundingSphere compute_bounding_sphere(const float* vertices, size_t num_vertices, size_t vertex_stride, const AABB& aabb) {
+		if (aabb.is_empty()) {
+			return BoundingSphere{};
+		}
+		const glm::vec3 center = aabb.get_center();
+		float max_distance_squared{};
+		for (size_t i = 0; i < num_vertices; i++) {
+			const float* p = vertices + i * vertex_stride;
+			const glm::vec3 d = glm::vec3(p[0], p[1], p[2]) - center;
+			max_distance_squared = std::max(max_distance_squared, glm::dot(d, d));
+		}
+		return BoundingSphere{ center, std::sqrt(max_distance_squared) };
+	}
+
+	// box around the transformed box (arvo's method)
+	AABB transform_aabb(const AABB& aabb, const glm::mat4& transform) {
+		if (aabb.is_empty()) {
+			return aabb;
+		}
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(aabb.get_center(), 1.0f));
+		const glm::vec3 extent = aabb.get_extent();
+		glm::vec3 new_extent{};
+		for (int axis = 0; axis < 3; axis++) {
+			new_extent[axis] = std::abs(transform[0][axis]) * extent.x + std::abs(transform[1][axis]) * extent.y + std::abs(transform[2][axis]) * extent.z;
+		}
+		return AABB{ center - new_extent, center + new_extent };
+	}
+
+	// frustum planes as (normal, distance) with the normal pointing inside, extracted from a clip matrix. with a
+	// model-view-projection matrix the planes are in model space
+	using Frustum = std::array<glm::vec4, 6>;
+
+	Frustum get_frustum_planes(const glm::mat4& clip) {
+		auto row = [&](int r) { return glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]); };
+		Frustum planes = {
+			row(3) + row(0), row(3) - row(0),
+			row(3) + row(1), row(3) - row(1),
+			row(3) + row(2), row(3) - row(2),
+		};
+		for (auto& plane : planes) {
+			plane = plane * (1.0f / glm::length(glm::vec3(plane)));
+		}
+		return planes;
+	}
+
+	bool is_outside_frustum(const glm::vec3& center, float radius, const Frustum& planes) {
+		for (const auto& plane : planes) {
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+				return true;
+			}
+		}
+		return false;
+	}
+	bool is_outside_frustum(const AABB& aabb, const Frustum& planes) {
+		if (aabb.is_empty()) {
+			return true;
+		}
+		const glm::vec3 center = aabb.get_center();
+		const glm::vec3 extent = aabb.get_extent();
+		for (const auto& plane : planes) {
+			const glm::vec3 n = glm::vec3(plane);
+			const float projected_extent = extent.x * std::abs(n.x) + extent.y * std::abs(n.y) + extent.z * std::abs(n.z);
+			if (glm::dot(n, center) + plane.w < -projected_extent) {
+				return true;
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <iostream>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <GL3D/shader.h>
+
+#include "vertex_layout.h"
+#include "range_allocator.h"
+
+namespace GLRenderer {
+
+	enum class IndexType {
+		uint16,
+		uint32
+	};
+	size_t get_index_size(IndexType index_type) {
+		return index_type == IndexType::uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+	GLenum get_gl_index_type(IndexType index_type) {
+		return index_type == IndexType::uint16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
+	// meshes with no more than 65535 vertices get 16 bit indices
+	IndexType choose_index_type(size_t num_vertices) {
+		return num_vertices <= 0xFFFF ? IndexType::uint16 : IndexType::uint32;
+	}
+
+	// index buffer contents packed into the narrowest type that addresses every vertex
+	struct IndexData {
+		IndexType type{};
+		size_t count{};
+		std::vector<unsigned char> bytes{};
+	};
+	IndexData pack_indices(std::span<const unsigned int> indices, size_t num_vertices) {
+		IndexData index_data{ choose_index_type(num_vertices), indices.size() };
+		index_data.bytes.resize(indices.size() * get_index_size(index_data.type));
+		if (index_data.type == IndexType::uint16) {
+			uint16_t* out = reinterpret_cast<uint16_t*>(index_data.bytes.data());
+			for (size_t i = 0; i < indices.size(); i++) {
+				out[i] = (uint16_t)indices[i];
+			}
+		}
+		else {
+			std::memcpy(index_data.bytes.data(), indices.data(), indices.size_bytes());
+		}
+		return index_data;
+	}
+
+	// one attribute of an interleaved vertex buffer, as passed to glVertexAttribPointer
+	struct GpuVertexAttrib {
+		GLuint location{};
+		GLint size{};
+		GLenum type{};
+		GLboolean normalized{};
+		size_t offset{}; // in bytes from the start of the vertex
+
+		bool operator==(const GpuVertexAttrib&) const = default;
+	};
+	struct GpuVertexFormat {
+		std::array<GpuVertexAttrib, MeshBuilder::max_vertex_attribs> attribs{};
+		size_t num_attribs{};
+		size_t stride{}; // in bytes
+
+		bool operator==(const GpuVertexFormat&) const = default;
+	};
+
+	// the shader locations are fixed per attribute type: position 0, normal 1, tex coord channel n at 2 + n
+	GLuint get_attrib_location(MeshBuilder::VertexAttribType type, unsigned int tex_coord_channel) {
+		switch (type)
+		{
+		case MeshBuilder::VertexAttribType::position:
+			return 0;
+		case MeshBuilder::VertexAttribType::normal:
+			return 1;
+		default:
+			return 2 + tex_coord_channel;
+		}
+	}
+	GpuVertexFormat get_float_vertex_format(const MeshBuilder::VertexFormat& vertex_format) {
+		GpuVertexFormat gpu_format{};
+		gpu_format.num_attribs = vertex_format.attribs.size();
+		gpu_format.stride = vertex_format.num_floats * sizeof(float);
+		size_t offset{};
+		unsigned int tex_coord_channel{};
+		for (size_t i = 0; i < vertex_format.attribs.size(); i++) {
+			const auto& attrib = vertex_format.attribs[i];
+			const GLuint location = get_attrib_location(attrib.type, tex_coord_channel);
+			if (attrib.type == MeshBuilder::VertexAttribType::tex_coord) {
+				tex_coord_channel++;
+			}
+			gpu_format.attribs[i] = GpuVertexAttrib{ location, (GLint)attrib.size, GL_FLOAT, GL_FALSE, offset };
+			offset += attrib.size * sizeof(float);
+		}
+		return gpu_format;
+	}
+
+	// contiguous part of an index buffer, in indices
+	struct IndexRange {
+		uint32_t offset{};
+		uint32_t count{};
+	};
+
+	// per instance model matrices for instanced draws, read by pbr_vertex_instanced.glsl from 4 consecutive locations
+	constexpr GLuint instance_matrix_location = 4;
+
+	class InstanceBuffer {
+	private:
+		GLuint buffer{};
+		size_t capacity{}; // in matrices
+
+	public:
+		InstanceBuffer() {
+			glGenBuffers(1, &buffer);
+		}
+
+		InstanceBuffer(const InstanceBuffer& rhs) = delete;
+
+		InstanceBuffer& operator=(const InstanceBuffer& rhs) = delete;
+
+		~InstanceBuffer() {
+			glDeleteBuffers(1, &buffer);
+		}
+
+		GLuint get_buffer() const {
+			return buffer;
+		}
+
+		// replaces the whole contents, the old storage is orphaned so the driver doesn't wait on earlier draws
+		void upload(std::span<const glm::mat4> matrices) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			capacity = std::max(capacity, matrices.size());
+			glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, 0, matrices.size_bytes(), matrices.data());
+		}
+	};
+
+	// where one mesh lives inside a GeometryPool. the pool updates it when it moves the data around
+	struct GeometryAllocation {
+		size_t base_vertex{};
+		size_t num_vertices{};
+		size_t index_offset{}; // in bytes
+		size_t index_bytes{};
+		IndexType index_type{};
+		GLsizei index_count{};
+	};
+
+	struct GeometryPoolStats {
+		size_t num_meshes{};
+		size_t vertex_stride{};
+		size_t vertex_capacity{}; // in vertices
+		size_t free_vertices{};
+		size_t vertex_free_blocks{};
+		size_t largest_free_vertex_block{};
+		size_t index_capacity{}; // in bytes
+		size_t free_index_bytes{};
+		size_t index_free_blocks{};
+		size_t largest_free_index_block{};
+	};
+
+	// one vao, vertex buffer and index buffer shared by every mesh with the same vertex format. meshes are drawn with
+	// a base vertex, so switching between them doesn't touch the vao. indices of both widths share the index buffer.
+	// instanced draws use a second vao over the same buffers, so the instance attributes never leak into plain draws
+	class GeometryPool {
+	private:
+		static constexpr size_t index_alignment = sizeof(uint32_t);
+		static constexpr float compaction_threshold = 0.25f;
+
+		GpuVertexFormat vertex_format{};
+		GLuint vao{};
+		GLuint instanced_vao{};
+		GLuint vertex_buffer{};
+		GLuint index_buffer{};
+		RangeAllocator vertex_ranges{}; // in vertices
+		RangeAllocator index_ranges{}; // in bytes
+		std::vector<std::unique_ptr<GeometryAllocation>> allocations{};
+
+		void bind_vao_buffers() {
+			for (GLuint current_vao : { vao, instanced_vao }) {
+				glBindVertexArray(current_vao);
+				glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+				for (size_t i = 0; i < vertex_format.num_attribs; i++) {
+					const auto& attrib = vertex_format.attribs[i];
+					glEnableVertexAttribArray(attrib.location);
+					glVertexAttribPointer(attrib.location, attrib.size, attrib.type, attrib.normalized, (GLsizei)vertex_format.stride, reinterpret_cast<const void*>(attrib.offset));
+				}
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+			}
+			// the instance matrix pointers depend on the draw, draw_instanced sets them
+			for (GLuint column = 0; column < 4; column++) {
+				glEnableVertexAttribArray(instance_matrix_location + column);
+				glVertexAttribDivisor(instance_matrix_location + column, 1);
+			}
+			glBindVertexArray(0);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		static GLuint create_buffer(size_t size) {
+			GLuint buffer{};
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+			return buffer;
+		}
+		static void copy_buffer(GLuint from, GLuint to, size_t from_offset, size_t to_offset, size_t size) {
+			if (size == 0) {
+				return;
+			}
+			glBindBuffer(GL_COPY_READ_BUFFER, from);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, to);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from_offset, to_offset, size);
+		}
+
+		// moves everything into new buffers of the given capacities. packing moves the allocations to the front
+		// in their current order, otherwise the contents are copied as they are and the capacities may only grow
+		void reallocate(size_t vertex_capacity, size_t index_capacity, bool pack) {
+			const GLuint new_vertex_buffer = create_buffer(vertex_capacity * vertex_format.stride);
+			const GLuint new_index_buffer = create_buffer(index_capacity);
+			if (pack) {
+				std::sort(allocations.begin(), allocations.end(), [](const auto& a, const auto& b) { return a->base_vertex < b->base_vertex; });
+				size_t vertex_end{};
+				for (auto& allocation : allocations) {
+					copy_buffer(vertex_buffer, new_vertex_buffer, allocation->base_vertex * vertex_format.stride, vertex_end * vertex_format.stride, allocation->num_vertices * vertex_format.stride);
+					allocation->base_vertex = vertex_end;
+					vertex_end += allocation->num_vertices;
+				}
+				std::sort(allocations.begin(), allocations.end(), [](const auto& a, const auto& b) { return a->index_offset < b->index_offset; });
+				size_t index_end{};
+				for (auto& allocation : allocations) {
+					copy_buffer(index_buffer, new_index_buffer, allocation->index_offset, index_end, allocation->index_bytes);
+					allocation->index_offset = index_end;
+					index_end += get_padded_index_bytes(allocation->index_bytes);
+				}
+				vertex_ranges.reset(vertex_end, vertex_capacity);
+				index_ranges.reset(index_end, index_capacity);
+			}
+			else {
+				copy_buffer(vertex_buffer, new_vertex_buffer, 0, 0, vertex_ranges.get_capacity() * vertex_format.stride);
+				copy_buffer(index_buffer, new_index_buffer, 0, 0, index_ranges.get_capacity());
+				vertex_ranges.grow(vertex_capacity);
+				index_ranges.grow(index_capacity);
+			}
+			glDeleteBuffers(1, &vertex_buffer);
+			glDeleteBuffers(1, &index_buffer);
+			vertex_buffer = new_vertex_buffer;
+			index_buffer = new_index_buffer;
+			bind_vao_buffers();
+		}
+
+	public:
+		// index ranges are padded to keep every mesh's indices 4 byte aligned
+		static size_t get_padded_index_bytes(size_t index_bytes) {
+			return (index_bytes + index_alignment - 1) / index_alignment * index_alignment;
+		}
+
+		explicit GeometryPool(const GpuVertexFormat& vertex_format) : vertex_format(vertex_format) {
+			glGenVertexArrays(1, &vao);
+			glGenVertexArrays(1, &instanced_vao);
+			vertex_buffer = create_buffer(0);
+			index_buffer = create_buffer(0);
+			bind_vao_buffers();
+		}
+
+		GeometryPool(const GeometryPool& rhs) = delete;
+
+		GeometryPool& operator=(const GeometryPool& rhs) = delete;
+
+		~GeometryPool() {
+			glDeleteBuffers(1, &index_buffer);
+			glDeleteBuffers(1, &vertex_buffer);
+			glDeleteVertexArrays(1, &instanced_vao);
+			glDeleteVertexArrays(1, &vao);
+		}
+
+		const GpuVertexFormat& get_vertex_format() const {
+			return vertex_format;
+		}
+
+		// grows the buffers so the given amount of data fits without further reallocation
+		void reserve(size_t num_vertices, size_t index_bytes) {
+			const size_t padded_index_bytes = get_padded_index_bytes(index_bytes);
+			const bool vertices_fit = vertex_ranges.get_largest_free_block() >= num_vertices;
+			const bool indices_fit = index_ranges.get_largest_free_block() >= padded_index_bytes;
+			if (!vertices_fit || !indices_fit) {
+				// growing by at least the requested size guarantees a free block at the end big enough for it
+				const size_t vertex_capacity = vertex_ranges.get_capacity();
+				const size_t index_capacity = index_ranges.get_capacity();
+				reallocate(vertices_fit ? vertex_capacity : std::max(vertex_capacity * 2, vertex_capacity + num_vertices),
+					indices_fit ? index_capacity : std::max(index_capacity * 2, index_capacity + padded_index_bytes), false);
+			}
+		}
+
+		const GeometryAllocation* add(std::span<const unsigned char> vertex_bytes, const IndexData& index_data) {
+			const size_t num_vertices = vertex_bytes.size() / vertex_format.stride;
+			reserve(num_vertices, index_data.bytes.size());
+			auto allocation = std::make_unique<GeometryAllocation>();
+			// empty parts take no range, reserve left a free block big enough for the others
+			allocation->base_vertex = num_vertices > 0 ? vertex_ranges.allocate(num_vertices).value() : 0;
+			allocation->num_vertices = num_vertices;
+			allocation->index_offset = index_data.bytes.empty() ? 0 : index_ranges.allocate(get_padded_index_bytes(index_data.bytes.size()), index_alignment).value();
+			allocation->index_bytes = index_data.bytes.size();
+			allocation->index_type = index_data.type;
+			allocation->index_count = (GLsizei)index_data.count;
+
+			glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, allocation->base_vertex * vertex_format.stride, vertex_bytes.size(), vertex_bytes.data());
+			glBindBuffer(GL_COPY_WRITE_BUFFER, index_buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, allocation->index_offset, index_data.bytes.size(), index_data.bytes.data());
+			allocations.push_back(std::move(allocation));
+			return allocations.back().get();
+		}
+
+		// only frees the ranges, compacting is left to whoever unloads meshes so tearing down a whole scene
+		// doesn't move data around for every mesh
+		void remove(const GeometryAllocation* allocation) {
+			auto it = std::find_if(allocations.begin(), allocations.end(), [&](const auto& a) { return a.get() == allocation; });
+			if (it == allocations.end()) {
+				return;
+			}
+			vertex_ranges.free((*it)->base_vertex, (*it)->num_vertices);
+			index_ranges.free((*it)->index_offset, get_padded_index_bytes((*it)->index_bytes));
+			allocations.erase(it);
+		}
+
+		// more than compaction_threshold of either buffer is free and split into several blocks
+		bool is_fragmented() const {
+			auto is_range_fragmented = [](const RangeAllocator& ranges) {
+				return ranges.get_num_free_blocks() > 1 && ranges.get_free_size() > ranges.get_capacity() * compaction_threshold;
+			};
+			return is_range_fragmented(vertex_ranges) || is_range_fragmented(index_ranges);
+		}
+
+		// moves every mesh to the front and shrinks the buffers to what is in use
+		void compact() {
+			const size_t used_vertices = vertex_ranges.get_capacity() - vertex_ranges.get_free_size();
+			const size_t used_index_bytes = index_ranges.get_capacity() - index_ranges.get_free_size();
+			reallocate(used_vertices, used_index_bytes, true);
+		}
+
+		GeometryPoolStats get_stats() const {
+			return GeometryPoolStats{
+				allocations.size(), vertex_format.stride,
+				vertex_ranges.get_capacity(), vertex_ranges.get_free_size(), vertex_ranges.get_num_free_blocks(), vertex_ranges.get_largest_free_block(),
+				index_ranges.get_capacity(), index_ranges.get_free_size(), index_ranges.get_num_free_blocks(), index_ranges.get_largest_free_block(),
+			};
+		}
+
+		// the vao is left bound, consecutive draws from the same pool don't switch it. draw_instanced switches to the
+		// instanced vao and back
+		void draw(const GeometryAllocation& allocation, IndexRange range) const {
+			glBindVertexArray(vao);
+			const size_t index_size = get_index_size(allocation.index_type);
+			glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)range.count, get_gl_index_type(allocation.index_type),
+				reinterpret_cast<const void*>(allocation.index_offset + range.offset * index_size), (GLint)allocation.base_vertex);
+		}
+		// draws instance_count copies reading their matrices from instance_buffer starting at first_instance. gl 3.3
+		// has no base instance, so the instance attributes are pointed at the first matrix instead
+		void draw_instanced(const GeometryAllocation& allocation, IndexRange range, const InstanceBuffer& instance_buffer, size_t first_instance, size_t instance_count) const {
+			glBindVertexArray(instanced_vao);
+			glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.get_buffer());
+			for (GLuint column = 0; column < 4; column++) {
+				const size_t offset = first_instance * sizeof(glm::mat4) + column * sizeof(glm::vec4);
+				glVertexAttribPointer(instance_matrix_location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<const void*>(offset));
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			const size_t index_size = get_index_size(allocation.index_type);
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.count, get_gl_index_type(allocation.index_type),
+				reinterpret_cast<const void*>(allocation.index_offset + range.offset * index_size), (GLsizei)instance_count, (GLint)allocation.base_vertex);
+			glBindVertexArray(vao);
+		}
+	};
+
+	// the pools of a scene, one per vertex format
+	class GeometryBuffers {
+	private:
+		std::vector<std::shared_ptr<GeometryPool>> pools{};
+
+	public:
+		std::shared_ptr<GeometryPool> get_pool(const GpuVertexFormat& vertex_format) {
+			for (const auto& pool : pools) {
+				if (pool->get_vertex_format() == vertex_format) {
+					return pool;
+				}
+			}
+			pools.push_back(std::make_shared<GeometryPool>(vertex_format));
+			return pools.back();
+		}
+
+		// call after unloading meshes
+		void compact_fragmented() {
+			for (auto& pool : pools) {
+				if (pool->is_fragmented()) {
+					pool->compact();
+				}
+			}
+		}
+
+		void print_report(std::ostream& out = std::cout) const {
+			out << "geometry buffers: " << pools.size() << " pools\n";
+			for (size_t i = 0; i < pools.size(); i++) {
+				const auto stats = pools[i]->get_stats();
+				// the share of the free space that is not in the largest block, 0 when all free space is contiguous
+				auto fragmentation = [](size_t free_size, size_t largest_block) {
+					return free_size > 0 ? 100.0 * (free_size - largest_block) / free_size : 0.0;
+				};
+				out << "  pool " << i << " (" << stats.vertex_stride << " byte vertices): " << stats.num_meshes << " meshes, "
+					<< "vertices " << stats.vertex_capacity - stats.free_vertices << "/" << stats.vertex_capacity << " used, "
+					<< stats.vertex_free_blocks << " free blocks, " << fragmentation(stats.free_vertices, stats.largest_free_vertex_block) << "% fragmented, "
+					<< "index bytes " << stats.index_capacity - stats.free_index_bytes << "/" << stats.index_capacity << " used, "
+					<< stats.index_free_blocks << " free blocks, " << fragmentation(stats.free_index_bytes, stats.largest_free_index_block) << "% fragmented\n";
+			}
+		}
+	};
+
+	// a mesh inside a shared GeometryPool, its data is freed from the pool when it is destroyed
+	class GpuMesh {
+	private:
+		std::shared_ptr<GeometryPool> pool{};
+		const GeometryAllocation* allocation{};
+
+	public:
+		GpuMesh(std::shared_ptr<GeometryPool> pool, std::span<const unsigned char> vertex_bytes, const IndexData& index_data)
+			: pool(std::move(pool)) {
+			allocation = this->pool->add(vertex_bytes, index_data);
+		}
+
+		GpuMesh(const GpuMesh& rhs) = delete;
+
+		GpuMesh& operator=(const GpuMesh& rhs) = delete;
+
+		~GpuMesh() {
+			pool->remove(allocation);
+		}
+
+		IndexType get_index_type() const {
+			return allocation->index_type;
+		}
+
+		size_t get_index_buffer_size() const {
+			return allocation->index_bytes;
+		}
+
+		uint32_t get_index_count() const {
+			return (uint32_t)allocation->index_count;
+		}
+
+		// every draw binds its program, a material without textures calls no setter that would make it current
+		void draw(const GL3D::ShaderProgram& shader) const {
+			shader.bind();
+			pool->draw(*allocation, IndexRange{ 0, (uint32_t)allocation->index_count });
+		}
+		void draw_ranges(const GL3D::ShaderProgram& shader, std::span<const IndexRange> ranges) const {
+			shader.bind();
+			for (const auto& range : ranges) {
+				pool->draw(*allocation, range);
+			}
+		}
+		void draw_instanced(const GL3D::ShaderProgram& shader, IndexRange range, const InstanceBuffer& instance_buffer, size_t first_instance, size_t instance_count) const {
+			shader.bind();
+			pool->draw_instanced(*allocation, range, instance_buffer, first_instance, instance_count);
+		}
+	};
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <sstream>
+#include <iostream>
+
+namespace MeshBuilder {
+
+	// numbers gathered by the import stages of a single mesh
+	struct MeshImportStats {
+		std::string name{};
+		size_t num_vertices{};
+		size_t num_indices{};
+		size_t index_bytes{}; // size of the uploaded index buffer
+		size_t index_bytes_32bit{}; // size it would have with 32 bit indices
+		double vertex_convert_seconds{};
+		size_t vertices_before_weld{}; // 0 when welding didn't run
+		size_t vertices_after_weld{};
+		float acmr_before{}; // 0 when the vertex cache optimization didn't run
+		float acmr_after{};
+		float overdraw_before{}; // 0 when the overdraw optimization didn't run
+		float overdraw_after{};
+		size_t vertex_bytes_before{}; // 0 when the vertex fetch optimization didn't run
+		size_t vertex_bytes_after{};
+		float overfetch_before{};
+		float overfetch_after{};
+		size_t uploaded_vertex_bytes{}; // size of the uploaded vertex buffer
+		bool quantized{}; // the fields below are only set when the vertices were quantized
+		size_t float_vertex_bytes{}; // size the vertex buffer would have with float attributes
+		float max_position_error{};
+		float max_normal_error_degrees{};
+		float max_uv_error{};
+		bool quantization_within_bounds{};
+		size_t num_meshlets{}; // 0 when meshlets weren't built
+		std::vector<size_t> lod_triangles{}; // triangles of every generated level below the full detail one
+		std::vector<float> lod_errors{};
+	};
+
+	// counts of the node tree before and after static batching, every node mesh is one draw call
+	struct StaticBatchStats {
+		size_t num_batches{};
+		size_t draw_calls_before{};
+		size_t draw_calls_after{};
+		size_t nodes_before{};
+		size_t nodes_after{};
+	};
+
+	struct ImportReport {
+		std::vector<MeshImportStats> meshes{}; // indexed like Scene::meshes
+		const char* vertex_kernel_name{};
+		StaticBatchStats static_batching{}; // all 0 when static batching didn't run
+	};
+
+	void print_import_report(const ImportReport& report, std::ostream& out = std::cout) {
+		size_t total_vertices{};
+		double total_convert_seconds{};
+		for (const auto& mesh : report.meshes) {
+			total_vertices += mesh.num_vertices;
+			total_convert_seconds += mesh.vertex_convert_seconds;
+		}
+		out << "import: " << report.meshes.size() << " meshes, " << total_vertices << " vertices\n";
+		if (total_convert_seconds > 0.0) {
+			out << "  vertex conversion (" << report.vertex_kernel_name << "): " << total_convert_seconds * 1000.0 << " ms, "
+				<< total_vertices / total_convert_seconds / 1.0e6 << " million vertices/s\n";
+		}
+		size_t total_index_bytes{};
+		size_t total_index_bytes_32bit{};
+		for (const auto& mesh : report.meshes) {
+			total_index_bytes += mesh.index_bytes;
+			total_index_bytes_32bit += mesh.index_bytes_32bit;
+		}
+		out << "  index buffers: " << total_index_bytes << " bytes, " << total_index_bytes_32bit - total_index_bytes << " bytes saved by 16 bit indices\n";
+		size_t total_vertex_bytes_saved{};
+		for (const auto& mesh : report.meshes) {
+			total_vertex_bytes_saved += mesh.vertex_bytes_before - mesh.vertex_bytes_after;
+		}
+		if (total_vertex_bytes_saved > 0) {
+			out << "  vertex fetch optimization: " << total_vertex_bytes_saved << " vertex buffer bytes saved\n";
+		}
+		size_t total_float_vertex_bytes{};
+		size_t total_quantized_vertex_bytes{};
+		for (const auto& mesh : report.meshes) {
+			if (mesh.quantized) {
+				total_float_vertex_bytes += mesh.float_vertex_bytes;
+				total_quantized_vertex_bytes += mesh.uploaded_vertex_bytes;
+			}
+		}
+		if (total_float_vertex_bytes > 0) {
+			out << "  vertex quantization: " << total_float_vertex_bytes << " -> " << total_quantized_vertex_bytes << " vertex buffer bytes\n";
+		}
+		const auto& batching = report.static_batching;
+		if (batching.nodes_before > 0) {
+			out << "  static batching: " << batching.num_batches << " batches, draw calls " << batching.draw_calls_before << " -> " << batching.draw_calls_after
+				<< ", nodes " << batching.nodes_before << " -> " << batching.nodes_after << "\n";
+		}
+		// one line per mesh listing the stages that ran on it
+		for (const auto& mesh : report.meshes) {
+			std::ostringstream line{};
+			if (mesh.vertices_before_weld > 0) {
+				line << ", welded " << mesh.vertices_before_weld << " -> " << mesh.vertices_after_weld << " vertices ("
+					<< 100.0 * (mesh.vertices_before_weld - mesh.vertices_after_weld) / mesh.vertices_before_weld << "% fewer)";
+			}
+			if (mesh.acmr_before > 0.0f) {
+				line << ", acmr " << mesh.acmr_before << " -> " << mesh.acmr_after;
+			}
+			if (mesh.overdraw_before > 0.0f) {
+				line << ", overdraw " << mesh.overdraw_before << " -> " << mesh.overdraw_after;
+			}
+			if (mesh.vertex_bytes_before > 0) {
+				line << ", vertex bytes " << mesh.vertex_bytes_before << " -> " << mesh.vertex_bytes_after << ", overfetch " << mesh.overfetch_before << " -> " << mesh.overfetch_after;
+			}
+			if (!mesh.lod_triangles.empty()) {
+				line << ", lods " << mesh.num_indices / 3;
+				for (size_t i = 0; i < mesh.lod_triangles.size(); i++) {
+					line << " -> " << mesh.lod_triangles[i] << " (error " << mesh.lod_errors[i] << ")";
+				}
+				line << " triangles";
+			}
+			if (mesh.num_meshlets > 0) {
+				line << ", " << mesh.num_meshlets << " meshlets";
+			}
+			if (mesh.quantized) {
+				line << ", quantized max error position " << mesh.max_position_error << " normal " << mesh.max_normal_error_degrees << " deg uv " << mesh.max_uv_error
+					<< (mesh.quantization_within_bounds ? "" : " (out of bounds)");
+			}
+			if (!line.str().empty()) {
+				out << "  " << mesh.name << ":" << line.str().substr(1) << "\n";
+			}
+		}
+	}
+}
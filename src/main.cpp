@@ -1,4 +1,5 @@
 #include "renderer.h"
+#include "benchmarks.h"
 
 
 static float mouse_sensitivity = 0.005f;
@@ -11,15 +12,22 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	renderer->on_window_resize(width, height);
 }
 
-int main() {
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+		return Benchmarks::run(std::string(TOSTRING(ASSET_DIR)) + "/") ? 0 : 1;
+	}
 	auto window = std::make_shared<GLExternalRAII::Window>(800, 800, OPENGL_VERSION_MAJOR, OPENGL_VERSION_MINOR);
 	auto renderer = std::make_shared<Renderer>(window);
 
 	renderer->cam.position = glm::vec3{ 0, 0, -1 };
 
 	const std::string asset_dir = std::string(TOSTRING(ASSET_DIR)) + "/";
-	auto candle_scene = MeshBuilder::build(asset_dir + "meshes/candle/brass_candleholders_1k.gltf").value();
-	renderer->scenes.push_back(std::move(candle_scene));
+	MeshBuilder::BuildOptions build_options{ .weld_vertices = true, .optimize_vertex_cache = true, .optimize_overdraw = true, .optimize_vertex_fetch = true, .quantize_vertices = true, .build_meshlets = true, .generate_lods = true, .bake_static_batches = true };
+	auto candle_scene = MeshBuilder::build(asset_dir + "meshes/candle/brass_candleholders_1k.gltf", build_options).value();
+	MeshBuilder::print_import_report(candle_scene.import_report);
+	candle_scene.geometry_buffers.print_report();
+	renderer->scene_instances.push_back(MeshBuilder::SceneInstance{ std::make_shared<const MeshBuilder::SceneAsset>(std::move(candle_scene)) });
+	TextureCache::get().print_report();
 
 	glfwSetInputMode(window->glfw_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetWindowUserPointer(window->glfw_window, renderer.get());
@@ -2,8 +2,17 @@
 
 #include <assert.h>
 #include <vector>
+#include <array>
 #include <memory>
 #include <span>
+#include <optional>
+#include <unordered_map>
+#include <set>
+#include <limits>
+#include <string_view>
+#include <memory_resource>
+#include <algorithm>
+#include <chrono>
 
 #include <tl/expected.hpp>
 #include <assimp/Importer.hpp>
@@ -14,33 +23,27 @@
 #include <GL3D/texture.h>
 
 #include "assimp_glm.h"
+#include "vertex_layout.h"
+#include "import_report.h"
+#include "mesh_optimizer.h"
+#include "gpu_mesh.h"
+#include "vertex_quantization.h"
+#include "meshlets.h"
+#include "mesh_simplifier.h"
+#include "bounds.h"
+#include "simd_kernels.h"
 #include "texture_builder.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+#include "transform_system.h"
 
 namespace MeshBuilder {
 
-	enum class VertexAttribType {
-		none = 0,
-		position,
-		normal,
-		tex_coord
-	};
-	struct VertexAttrib {
-		size_t size{}; // this is the size of one vertex attribute based on the size of float. if an attrib contains 3 floats, the size will be 3
-		VertexAttribType type{};
-	};
-	std::vector<int> get_num_floats_per_attribute(const std::vector<VertexAttrib>& vertex_attribs) {
-		std::vector<int> num_floats_per_attribute{};
-		for (const auto& vertex_attrib : vertex_attribs) {
-			num_floats_per_attribute.push_back(vertex_attrib.size);
-		}
-		return num_floats_per_attribute;
-	}
-
 	struct Material {
-		std::unique_ptr<GL3D::Texture> diffuse_texture{};
-		std::unique_ptr<GL3D::Texture> metallic_texture{};
-		std::unique_ptr<GL3D::Texture> roughness_texture{};
-		std::unique_ptr<GL3D::Texture> normal_texture{};
+		std::shared_ptr<GL3D::Texture> diffuse_texture{};
+		std::shared_ptr<GL3D::Texture> metallic_texture{};
+		std::shared_ptr<GL3D::Texture> roughness_texture{};
+		std::shared_ptr<GL3D::Texture> normal_texture{};
 	};
 	std::vector<std::string> get_all_texture_paths_from_type(const aiMaterial* ai_material, const aiTextureType ai_texture_type) {
 		std::vector<std::string> texture_paths{};
@@ -55,81 +58,199 @@ namespace MeshBuilder {
 		}
 		return texture_paths;
 	}
-	std::unique_ptr<GL3D::Texture> process_texture(std::filesystem::path model_dir, const aiMaterial* ai_material,const aiTextureType ai_texture_type) {
+	constexpr aiTextureType material_texture_types[] = { aiTextureType_BASE_COLOR, aiTextureType_METALNESS, aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_NORMALS };
+
+	std::optional<std::filesystem::path> get_texture_path(std::filesystem::path model_dir, const aiMaterial* ai_material, const aiTextureType ai_texture_type) {
 		auto texture_paths = get_all_texture_paths_from_type(ai_material, ai_texture_type);
 		if (texture_paths.size() == 0) {
-			return nullptr;
+			return std::nullopt;
 		}
 		if (texture_paths.size() > 1) {
 			assert(false && "more than 1 texture found for a type");
 		}
 		std::filesystem::path texture_path = texture_paths[0];
-		auto texture = TextureBuilder::build(model_dir / texture_path).value_or(nullptr);
-		return texture;
-	}
-	Material process_material(std::filesystem::path model_dir, const aiMaterial* ai_material) {
-		auto diffuse_texture = process_texture(model_dir, ai_material, aiTextureType_BASE_COLOR);
-		auto metallic_texture = process_texture(model_dir, ai_material, aiTextureType_METALNESS);
-		auto roughness_texture = process_texture(model_dir, ai_material, aiTextureType_DIFFUSE_ROUGHNESS);
-		auto normal_texture = process_texture(model_dir, ai_material, aiTextureType_NORMALS);
+		return model_dir / texture_path;
+	}
+	// every distinct texture path referenced by the materials of the scene
+	std::vector<std::filesystem::path> get_all_texture_paths(std::filesystem::path model_dir, const aiScene* ai_scene) {
+		std::vector<std::filesystem::path> texture_paths{};
+		for (size_t i = 0; i < ai_scene->mNumMaterials; i++) {
+			for (auto ai_texture_type : material_texture_types) {
+				auto texture_path = get_texture_path(model_dir, ai_scene->mMaterials[i], ai_texture_type);
+				if (texture_path.has_value() && std::find(texture_paths.begin(), texture_paths.end(), texture_path.value()) == texture_paths.end()) {
+					texture_paths.push_back(texture_path.value());
+				}
+			}
+		}
+		return texture_paths;
+	}
+
+	using TextureTable = std::unordered_map<std::string, std::shared_ptr<GL3D::Texture>>; // keyed by texture path
+
+	std::shared_ptr<GL3D::Texture> process_texture(std::filesystem::path model_dir, const TextureTable& textures, const aiMaterial* ai_material, const aiTextureType ai_texture_type) {
+		auto texture_path = get_texture_path(model_dir, ai_material, ai_texture_type);
+		if (!texture_path.has_value()) {
+			return nullptr;
+		}
+		auto it = textures.find(texture_path.value().string());
+		if (it == textures.end()) {
+			return nullptr;
+		}
+		return it->second;
+	}
+	Material process_material(std::filesystem::path model_dir, const TextureTable& textures, const aiMaterial* ai_material) {
+		auto diffuse_texture = process_texture(model_dir, textures, ai_material, aiTextureType_BASE_COLOR);
+		auto metallic_texture = process_texture(model_dir, textures, ai_material, aiTextureType_METALNESS);
+		auto roughness_texture = process_texture(model_dir, textures, ai_material, aiTextureType_DIFFUSE_ROUGHNESS);
+		auto normal_texture = process_texture(model_dir, textures, ai_material, aiTextureType_NORMALS);
 		return Material{ std::move(diffuse_texture), std::move(metallic_texture), std::move(roughness_texture), std::move(normal_texture) };
 	}
+	// the returned table is indexed by aiMesh::mMaterialIndex so meshes sharing a material share its textures
+	std::vector<std::shared_ptr<Material>> process_materials(std::filesystem::path model_dir, const TextureTable& textures, const aiScene* ai_scene) {
+		std::vector<std::shared_ptr<Material>> materials{};
+		materials.reserve(ai_scene->mNumMaterials);
+		for (size_t i = 0; i < ai_scene->mNumMaterials; i++)
+		{
+			materials.push_back(std::make_shared<Material>(process_material(model_dir, textures, ai_scene->mMaterials[i])));
+		}
+		return materials;
+	}
+
+	// one detail level of a mesh, all levels share the vertex buffer and live in the same index buffer
+	struct MeshLod {
+		GLRenderer::IndexRange range{};
+		float error{}; // geometric deviation from level 0, in mesh units
+	};
+	struct MeshLods {
+		std::vector<MeshLod> levels{}; // finest first, empty when lods weren't generated
+	};
 
 	struct Mesh {
-		std::unique_ptr<GL3D::Mesh> mesh{};
-		std::vector<VertexAttrib> vertex_attribs{};
-		Material material{};
+		std::unique_ptr<GLRenderer::GpuMesh> mesh{};
+		VertexFormat vertex_format{};
+		std::shared_ptr<Material> material{}; // handle into Scene::materials
+		glm::mat4 dequantization{ 1.0f }; // maps quantized positions back into mesh space, identity for float vertices
+		Meshlets::MeshletData meshlets{}; // empty unless BuildOptions::build_meshlets is set, covers lod 0 only
+		MeshLods lods{};
+		// in mesh space, computed from the unquantized positions
+		Bounds::AABB aabb{};
+		Bounds::BoundingSphere bounding_sphere{};
+	};
+
+	// optional import stages, all of them off by default
+	struct BuildOptions {
+		bool weld_vertices = false; // merge duplicate vertices before any other stage
+		float weld_epsilon = 0.0f; // vertices are merged when all their floats round to the same multiple of this, 0 means exact
+		bool optimize_vertex_cache = false; // reorder triangles for post transform vertex cache locality
+		bool optimize_overdraw = false; // reorder triangle clusters to reduce overdraw, implies optimize_vertex_cache
+		float overdraw_threshold = 1.05f; // max acmr increase the overdraw pass may cause, relative to the cache optimized order
+		bool optimize_vertex_fetch = false; // renumber vertices in first use order and drop unreferenced ones, runs after the index stages
+		bool quantize_vertices = false; // upload snorm16 positions, octahedral normals and half float uvs instead of floats
+		bool build_meshlets = false; // split triangle lists into culling clusters, runs after the other index stages
+		bool generate_lods = false; // append simplified index buffers of the triangle lists, runs after vertex fetch
+		size_t num_lods = 4; // max number of levels below the full detail one
+		float lod_reduction = 0.5f; // fraction of the triangles every level keeps from the previous one
+		float lod_max_error = 0.05f; // max geometric error of any level, relative to the mesh radius
+		bool bake_static_batches = false; // pre-transform static meshes and merge them by material, see bake_static_batches
+		std::vector<std::string> dynamic_nodes{}; // names of the nodes whose subtrees stay movable when baking
+	};
+
+	// cpu side result of processing an aiMesh, waiting to be uploaded
+	struct MeshData {
+		std::vector<float> vertices{};
+		std::vector<unsigned int> indices{};
+		VertexFormat vertex_format{};
+		unsigned int material_index{};
+		bool is_triangle_list = true;
+		bool is_used = true; // false once static batching merged every instance of the mesh into batches
+		MeshImportStats stats{};
+		GLRenderer::IndexData index_data{}; // indices packed for upload, the last step of the cpu stage
+		std::optional<VertexQuantization::QuantizedVertices> quantized{}; // replaces vertices at upload when set
+		Meshlets::MeshletData meshlets{};
+		MeshLods lods{};
+		Bounds::AABB aabb{};
+		Bounds::BoundingSphere bounding_sphere{};
 	};
 
-	Mesh process_mesh(std::filesystem::path model_dir, const aiScene* ai_scene, const aiMesh* ai_mesh) {
-		std::vector<VertexAttrib> vertex_attribs{};
-		if (ai_mesh->HasPositions()) {
-			vertex_attribs.push_back({ 3, VertexAttribType::position });
+	// runs the optional import stages enabled in options. the index stages only apply to pure triangle lists
+	void optimize_mesh_data(MeshData& mesh_data, const BuildOptions& options) {
+		const bool is_triangle_list = mesh_data.is_triangle_list;
+		auto& vertices = mesh_data.vertices;
+		auto& indices = mesh_data.indices;
+		auto& stats = mesh_data.stats;
+		const size_t vertex_stride = mesh_data.vertex_format.num_floats;
+		const size_t vertex_size = vertex_stride * sizeof(float);
+
+		if (options.weld_vertices) {
+			stats.vertices_before_weld = vertices.size() / vertex_stride;
+			MeshOptimizer::weld_vertices(indices, vertices, vertex_stride, options.weld_epsilon);
+			stats.vertices_after_weld = vertices.size() / vertex_stride;
 		}
-		if (ai_mesh->HasNormals()) {
-			vertex_attribs.push_back({ 3, VertexAttribType::normal });
+		const size_t num_vertices = vertices.size() / vertex_stride;
+
+		const MeshOptimizer::PositionStream positions{ vertices.data(), num_vertices, vertex_stride };
+		if (is_triangle_list && (options.optimize_vertex_cache || options.optimize_overdraw)) {
+			stats.acmr_before = MeshOptimizer::compute_acmr(indices, num_vertices);
+			indices = MeshOptimizer::optimize_vertex_cache(indices, num_vertices);
+			if (options.optimize_overdraw) {
+				stats.overdraw_before = MeshOptimizer::analyze_overdraw(indices, positions).overdraw;
+				indices = MeshOptimizer::optimize_overdraw(indices, positions, options.overdraw_threshold);
+				stats.overdraw_after = MeshOptimizer::analyze_overdraw(indices, positions).overdraw;
+			}
+			stats.acmr_after = MeshOptimizer::compute_acmr(indices, num_vertices);
 		}
-		for (size_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
-		{
-			auto ai_tex_coord = ai_mesh->mTextureCoords[i];
-			if (!ai_tex_coord) {
-				continue;
+		if (is_triangle_list && options.optimize_vertex_fetch) {
+			stats.vertex_bytes_before = vertices.size() * sizeof(float);
+			stats.overfetch_before = MeshOptimizer::analyze_vertex_fetch(indices, num_vertices, vertex_size);
+			MeshOptimizer::optimize_vertex_fetch(indices, vertices, vertex_stride);
+			stats.vertex_bytes_after = vertices.size() * sizeof(float);
+			stats.overfetch_after = MeshOptimizer::analyze_vertex_fetch(indices, vertices.size() / vertex_stride, vertex_size);
+		}
+		// the vertex fetch stage may have reallocated the vertices
+		const MeshOptimizer::PositionStream final_positions{ vertices.data(), vertices.size() / vertex_stride, vertex_stride };
+		if (is_triangle_list && options.build_meshlets) {
+			mesh_data.meshlets = Meshlets::build_meshlets(indices, final_positions);
+			stats.num_meshlets = mesh_data.meshlets.meshlets.size();
+		}
+		if (is_triangle_list && options.generate_lods) {
+			// the levels are appended to the index buffer after the meshlets were built on the full detail level
+			auto chain = MeshSimplifier::build_lod_chain(indices, final_positions, options.num_lods, options.lod_reduction, options.lod_max_error);
+			auto& lods = mesh_data.lods;
+			lods.levels.push_back(MeshLod{ GLRenderer::IndexRange{ 0, (uint32_t)indices.size() }, 0.0f });
+			for (auto& level : chain.levels) {
+				lods.levels.push_back(MeshLod{ GLRenderer::IndexRange{ (uint32_t)indices.size(), (uint32_t)level.indices.size() }, level.error });
+				stats.lod_triangles.push_back(level.indices.size() / 3);
+				stats.lod_errors.push_back(level.error);
+				indices.insert(indices.end(), level.indices.begin(), level.indices.end());
 			}
-			vertex_attribs.push_back({ 2, VertexAttribType::tex_coord });
 		}
+	}
+
+	// doesn't touch gl, safe to call from worker threads
+	MeshData convert_mesh_data(const aiMesh* ai_mesh) {
+		MeshImportStats stats{};
+		stats.name = std::string(ai_mesh->mName.data, ai_mesh->mName.length);
+		stats.num_vertices = ai_mesh->mNumVertices;
 
 		std::vector<float> vertices{};
 		// process vertices
-		for (size_t i = 0; i < ai_mesh->mNumVertices; i++)
-		{
-			// process position;
-			auto ai_pos = ai_mesh->mVertices[i];
-			vertices.push_back(ai_pos.x);
-			vertices.push_back(ai_pos.y);
-			vertices.push_back(ai_pos.z);
-			// process normals
-			if (ai_mesh->HasNormals()) {
-				auto ai_normal = ai_mesh->mNormals[i];
-				vertices.push_back(ai_normal.x);
-				vertices.push_back(ai_normal.y);
-				vertices.push_back(ai_normal.z);
-			}
-			// process tex coords
-			for (size_t j = 0; j < AI_MAX_NUMBER_OF_TEXTURECOORDS; j++)
-			{
-				auto ai_tex_coord = ai_mesh->mTextureCoords[j];
-				if (!ai_tex_coord) {
-					continue;
-				}
-				vertices.push_back(ai_tex_coord[i].x);
-				vertices.push_back(ai_tex_coord[i].y);
-			}
-		}
+		const auto convert_start = std::chrono::steady_clock::now();
+		const VertexFormat vertex_format = visit_vertex_layout(ai_mesh, [&](auto layout) {
+			using Layout = decltype(layout);
+			vertices.resize(ai_mesh->mNumVertices * Layout::num_floats);
+			Layout::convert(ai_mesh, vertices.data());
+			return Layout::get_format();
+		});
+		stats.vertex_convert_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - convert_start).count();
+
 		std::vector<unsigned int> indices{};
+		indices.reserve(ai_mesh->mNumFaces * 3);
+		bool is_triangle_list = true;
 		// process indices
 		for (size_t i = 0; i < ai_mesh->mNumFaces; i++)
 		{
 			auto& ai_face = ai_mesh->mFaces[i];
+			is_triangle_list = is_triangle_list && ai_face.mNumIndices == 3;
 			for (size_t j = 0; j < ai_face.mNumIndices; j++)
 			{
 				auto indice = ai_face.mIndices[j];
@@ -137,65 +258,1004 @@ namespace MeshBuilder {
 			}
 		}
 
-		auto num_floats_per_attr = get_num_floats_per_attribute(vertex_attribs);
-		auto created_mesh = std::make_unique<GL3D::Mesh>(std::span<float>(vertices.data(), vertices.size()), std::span<int>(num_floats_per_attr.data(), num_floats_per_attr.size()), std::span<unsigned int>(indices.data(), indices.size()));
-		
-		auto ai_material = ai_scene->mMaterials[ai_mesh->mMaterialIndex];
-		Material material = process_material(model_dir, ai_material);
-		return Mesh{ std::move(created_mesh), vertex_attribs, std::move(material) };
+		stats.num_indices = indices.size();
+
+		return MeshData{ std::move(vertices), std::move(indices), vertex_format, ai_mesh->mMaterialIndex, is_triangle_list, true, std::move(stats) };
 	}
-	struct Node {
-		std::string name{};
-		glm::mat4 transform{};
-		std::vector<Mesh> meshes{};
-		Node* parent{};
-		std::vector<std::unique_ptr<Node>> child_nodes{};
+	// runs the import stages on converted data and prepares it for upload. doesn't touch gl either
+	void finish_mesh_data(MeshData& mesh_data, const BuildOptions& options) {
+		const VertexFormat vertex_format = mesh_data.vertex_format;
+		optimize_mesh_data(mesh_data, options);
 
-		glm::mat4 get_global_transform() const {
-			if (!parent) {
-				return glm::mat4(1.0f);
+		const size_t num_vertices = mesh_data.vertices.size() / vertex_format.num_floats;
+		mesh_data.aabb = Bounds::compute_aabb(mesh_data.vertices.data(), num_vertices, vertex_format.num_floats);
+		mesh_data.bounding_sphere = Bounds::compute_bounding_sphere(mesh_data.vertices.data(), num_vertices, vertex_format.num_floats, mesh_data.aabb);
+		mesh_data.index_data = GLRenderer::pack_indices(mesh_data.indices, num_vertices);
+		mesh_data.stats.index_bytes = mesh_data.index_data.bytes.size();
+		mesh_data.stats.index_bytes_32bit = mesh_data.indices.size() * sizeof(uint32_t);
+
+		mesh_data.stats.uploaded_vertex_bytes = mesh_data.vertices.size() * sizeof(float);
+		if (options.quantize_vertices) {
+			mesh_data.quantized = VertexQuantization::quantize(mesh_data.vertices, vertex_format);
+			auto& quantized = *mesh_data.quantized;
+			mesh_data.stats.quantized = true;
+			mesh_data.stats.float_vertex_bytes = mesh_data.stats.uploaded_vertex_bytes;
+			mesh_data.stats.uploaded_vertex_bytes = quantized.bytes.size();
+			mesh_data.stats.max_position_error = quantized.error.max_position_error;
+			mesh_data.stats.max_normal_error_degrees = quantized.error.max_normal_error_degrees;
+			mesh_data.stats.max_uv_error = quantized.error.max_uv_error;
+			mesh_data.stats.quantization_within_bounds = quantized.error.within_bounds;
+		}
+	}
+	// the vertex bytes to upload and their gpu format, quantized when that stage ran
+	struct UploadVertices {
+		std::span<const unsigned char> bytes{};
+		GLRenderer::GpuVertexFormat format{};
+	};
+	UploadVertices get_upload_vertices(const MeshData& mesh_data) {
+		if (mesh_data.quantized) {
+			return UploadVertices{ mesh_data.quantized->bytes, mesh_data.quantized->format };
+		}
+		const std::span<const unsigned char> vertex_bytes(reinterpret_cast<const unsigned char*>(mesh_data.vertices.data()), mesh_data.vertices.size() * sizeof(float));
+		return UploadVertices{ vertex_bytes, GLRenderer::get_float_vertex_format(mesh_data.vertex_format) };
+	}
+	// must be called on the thread owning the gl context
+	Mesh upload_mesh(MeshData& mesh_data, const std::vector<std::shared_ptr<Material>>& scene_materials, GLRenderer::GeometryBuffers& geometry_buffers) {
+		Mesh mesh{};
+		mesh.vertex_format = mesh_data.vertex_format;
+		mesh.material = scene_materials[mesh_data.material_index];
+		mesh.meshlets = std::move(mesh_data.meshlets);
+		mesh.lods = std::move(mesh_data.lods);
+		mesh.aabb = mesh_data.aabb;
+		mesh.bounding_sphere = mesh_data.bounding_sphere;
+		if (mesh_data.quantized) {
+			mesh.dequantization = mesh_data.quantized->dequantization;
+		}
+		const auto upload_vertices = get_upload_vertices(mesh_data);
+		mesh.mesh = std::make_unique<GLRenderer::GpuMesh>(geometry_buffers.get_pool(upload_vertices.format), upload_vertices.bytes, mesh_data.index_data);
+		return mesh;
+	}
+	// uploads every aiScene::mMeshes[i] exactly once. the returned table is indexed by the assimp mesh index
+	// so nodes referencing the same mesh share one gpu mesh instead of uploading their own copy. unused meshes
+	// get a null entry, static batches follow the assimp meshes
+	std::vector<std::shared_ptr<Mesh>> upload_meshes(std::vector<MeshData>& meshes_data, const std::vector<std::shared_ptr<Material>>& scene_materials, GLRenderer::GeometryBuffers& geometry_buffers) {
+		// size every pool for all of its meshes up front so the uploads don't grow the buffers one by one
+		struct PoolSize {
+			std::shared_ptr<GLRenderer::GeometryPool> pool{};
+			size_t num_vertices{};
+			size_t index_bytes{};
+		};
+		std::vector<PoolSize> pool_sizes{};
+		for (const auto& mesh_data : meshes_data) {
+			if (!mesh_data.is_used) {
+				continue;
+			}
+			const auto upload_vertices = get_upload_vertices(mesh_data);
+			auto pool = geometry_buffers.get_pool(upload_vertices.format);
+			auto it = std::find_if(pool_sizes.begin(), pool_sizes.end(), [&](const PoolSize& size) { return size.pool == pool; });
+			if (it == pool_sizes.end()) {
+				pool_sizes.push_back(PoolSize{ pool });
+				it = std::prev(pool_sizes.end());
 			}
-			return transform * parent->get_global_transform();
+			it->num_vertices += upload_vertices.bytes.size() / upload_vertices.format.stride;
+			it->index_bytes += GLRenderer::GeometryPool::get_padded_index_bytes(mesh_data.index_data.bytes.size());
+		}
+		for (auto& size : pool_sizes) {
+			size.pool->reserve(size.num_vertices, size.index_bytes);
+		}
+
+		std::vector<std::shared_ptr<Mesh>> meshes{};
+		meshes.reserve(meshes_data.size());
+		for (auto& mesh_data : meshes_data)
+		{
+			meshes.push_back(mesh_data.is_used ? std::make_shared<Mesh>(upload_mesh(mesh_data, scene_materials, geometry_buffers)) : nullptr);
 		}
+		return meshes;
+	}
+	constexpr uint32_t no_node = std::numeric_limits<uint32_t>::max();
+
+	struct NodeLinks {
+		uint32_t parent{ no_node };
+		uint32_t first_child{};
+		uint32_t num_children{};
+		uint32_t first_mesh{}; // into the storage's mesh handles
+		uint32_t num_meshes{};
 	};
-	std::unique_ptr<Node> process_single_node(std::filesystem::path model_dir, const aiScene* scene, const aiNode* node) {
-		auto node_data = std::make_unique<Node>();
-		node_data->name = std::string(node->mName.data, node->mName.length);
-		node_data->transform = assimp_matrix_to_glm_matrix(node->mTransformation);
-		for (size_t i = 0; i < node->mNumMeshes; i++)
+	struct NodeStorageSize {
+		size_t num_nodes{};
+		size_t num_mesh_refs{};
+		size_t name_bytes{};
+	};
+
+	// all nodes of a scene in flat arrays, breadth first: the root is node 0, parents come before their children, the
+	// children of a node are contiguous and every depth is one contiguous level. the arrays are reserved up front from
+	// one arena, so loading a scene allocates its nodes once however many there are.
+	// world matrices and bounds are cached: set_transform marks the node dirty and update_transforms, called once per
+	// frame, refreshes the changed subtrees
+	class NodeStorage {
+	public:
+		explicit NodeStorage(const NodeStorageSize& size)
+			: arena(get_arena_bytes(size)), links(&arena), name_ranges(&arena), name_chars(&arena), transforms(&arena),
+			global_transforms(&arena), dirty(&arena), mesh_bounds(&arena), bounds(&arena), meshes(&arena), level_offsets(&arena)
 		{
-			unsigned int mesh_idx = node->mMeshes[i];
-			auto result_mesh = process_mesh(model_dir, scene, scene->mMeshes[mesh_idx]);
-			node_data->meshes.push_back(std::move(result_mesh));
+			links.reserve(size.num_nodes);
+			name_ranges.reserve(size.num_nodes);
+			name_chars.reserve(size.name_bytes);
+			transforms.reserve(size.num_nodes);
+			global_transforms.reserve(size.num_nodes);
+			dirty.reserve(size.num_nodes);
+			mesh_bounds.reserve(size.num_nodes);
+			bounds.reserve(size.num_nodes);
+			meshes.reserve(size.num_mesh_refs);
+			level_offsets.reserve(reserved_levels);
+		}
+		NodeStorage(const NodeStorage&) = delete;
+		NodeStorage& operator=(const NodeStorage&) = delete;
+
+		// nodes have to be appended breadth first, starting with the root. returns the new node's index
+		uint32_t append_node(uint32_t parent, std::string_view name, const glm::mat4& transform) {
+			const uint32_t node = (uint32_t)links.size();
+			assert((parent == no_node) == (node == 0) && (parent == no_node || parent < node));
+			if (parent != no_node) {
+				auto& parent_links = links[parent];
+				assert(parent_links.num_children == 0 || parent_links.first_child + parent_links.num_children == node);
+				if (parent_links.num_children++ == 0) {
+					parent_links.first_child = node;
+				}
+			}
+			// a node whose parent is on the last level starts a new one
+			if (parent == no_node || parent >= level_offsets.back()) {
+				level_offsets.push_back(node);
+			}
+			links.push_back(NodeLinks{ parent, node, 0, (uint32_t)meshes.size(), 0 });
+			name_ranges.push_back({ (uint32_t)name_chars.size(), (uint32_t)name.size() });
+			name_chars.insert(name_chars.end(), name.begin(), name.end());
+			transforms.push_back(transform);
+			global_transforms.push_back(glm::mat4(1.0f));
+			dirty.push_back(1);
+			first_dirty = std::min(first_dirty, node);
+			mesh_bounds.push_back(Bounds::AABB{});
+			bounds.push_back(Bounds::AABB{});
+			return node;
+		}
+		// adds a mesh to the node appended last
+		void append_mesh(const std::shared_ptr<Mesh>& mesh) {
+			assert(!links.empty());
+			meshes.push_back(mesh);
+			links.back().num_meshes++;
+		}
+
+		size_t size() const { return links.size(); }
+		size_t get_num_mesh_refs() const { return meshes.size(); }
+		size_t get_num_levels() const { return level_offsets.size(); }
+		// first node and node count of a depth
+		std::pair<uint32_t, uint32_t> get_level(size_t depth) const {
+			const uint32_t end = depth + 1 < level_offsets.size() ? level_offsets[depth + 1] : (uint32_t)links.size();
+			return { level_offsets[depth], end - level_offsets[depth] };
+		}
+		const NodeLinks& get_links(uint32_t node) const { return links[node]; }
+		std::string_view get_name(uint32_t node) const {
+			return std::string_view(name_chars.data() + name_ranges[node].first, name_ranges[node].second);
+		}
+		const glm::mat4& get_transform(uint32_t node) const { return transforms[node]; }
+		std::span<const std::shared_ptr<Mesh>> get_meshes(uint32_t node) const {
+			return std::span<const std::shared_ptr<Mesh>>(meshes).subspan(links[node].first_mesh, links[node].num_meshes);
+		}
+		const Bounds::AABB& get_mesh_bounds(uint32_t node) const { return mesh_bounds[node]; }
+		const Bounds::AABB& get_bounds(uint32_t node) const { return bounds[node]; }
+
+		// cached, valid after update_transforms
+		const glm::mat4& get_global_transform(uint32_t node) const {
+			assert(first_dirty == no_node);
+			return global_transforms[node];
+		}
+		// walks up to the root without the cache
+		glm::mat4 compute_global_transform(uint32_t node) const {
+			// the root's own transform never applies
+			glm::mat4 global_transform(1.0f);
+			for (; links[node].parent != no_node; node = links[node].parent) {
+				global_transform = global_transform * transforms[node];
+			}
+			return global_transform;
+		}
+		// the world matrices and bounds of the subtree follow on the next update_transforms
+		void set_transform(uint32_t node, const glm::mat4& transform) {
+			transforms[node] = transform;
+			dirty[node] = 1;
+			first_dirty = std::min(first_dirty, node);
+		}
+		bool is_dirty() const {
+			return first_dirty != no_node;
+		}
+		// breadth first, one level at a time: every parent updates its children in one batch, all of them when it
+		// changed itself and the dirty ones otherwise, so the flags spread over the changed subtrees. then bottom up,
+		// every node with a change below it merges its bounds again and clears its children's flags. a node only
+		// writes its own and its children's entries, so the levels are split across the thread pool
+		void update_transforms(bool parallel = true) {
+			if (first_dirty == no_node) {
+				return;
+			}
+			if (dirty[0]) {
+				global_transforms[0] = glm::mat4(1.0f);
+				mesh_bounds[0] = compute_mesh_bounds(0, global_transforms[0]);
+			}
+			for (size_t depth = 0; depth + 1 < level_offsets.size(); depth++) {
+				// nothing changed up to the end of the children's level
+				const auto [first_child, num_children] = get_level(depth + 1);
+				if (first_child + num_children <= first_dirty) {
+					continue;
+				}
+				const auto [first, count] = get_level(depth);
+				TransformSystem::for_each_chunk(first, count, parallel, [this](size_t begin, size_t end) {
+					for (size_t node = begin; node < end; node++) {
+						update_children((uint32_t)node);
+					}
+				});
+			}
+			for (size_t depth = level_offsets.size(); depth-- > 0;) {
+				const auto [first, count] = get_level(depth);
+				TransformSystem::for_each_chunk(first, count, parallel, [this](size_t begin, size_t end) {
+					for (size_t node = begin; node < end; node++) {
+						merge_changed_bounds((uint32_t)node);
+					}
+				});
+			}
+			dirty[0] = 0;
+			first_dirty = no_node;
+		}
+
+	private:
+		static constexpr size_t reserved_levels = 64;
+
+		static size_t get_arena_bytes(const NodeStorageSize& size) {
+			const size_t node_bytes = sizeof(NodeLinks) + sizeof(std::pair<uint32_t, uint32_t>) + 2 * sizeof(glm::mat4) + sizeof(uint8_t) + 2 * sizeof(Bounds::AABB);
+			// every array may need padding for its alignment
+			const size_t padding = 11 * alignof(std::max_align_t);
+			return size.num_nodes * node_bytes + size.num_mesh_refs * sizeof(std::shared_ptr<Mesh>) + size.name_bytes + reserved_levels * sizeof(uint32_t) + padding;
+		}
+		// the mesh boxes are gathered into small batches for the simd kernel, this runs on the transform workers
+		Bounds::AABB compute_mesh_bounds(uint32_t node, const glm::mat4& global_transform) const {
+			constexpr size_t batch_size = 16;
+			std::array<Bounds::AABB, batch_size> local_bounds{};
+			std::array<Bounds::AABB, batch_size> global_bounds{};
+			Bounds::AABB node_mesh_bounds{};
+			const auto meshes = get_meshes(node);
+			for (size_t first = 0; first < meshes.size(); first += batch_size) {
+				const size_t count = std::min(batch_size, meshes.size() - first);
+				for (size_t i = 0; i < count; i++) {
+					local_bounds[i] = meshes[first + i]->aabb;
+				}
+				SimdKernels::transform_aabbs(global_transform, local_bounds.data(), global_bounds.data(), count);
+				for (size_t i = 0; i < count; i++) {
+					node_mesh_bounds.expand(global_bounds[i]);
+				}
+			}
+			return node_mesh_bounds;
+		}
+		void update_children(uint32_t parent) {
+			const uint32_t first_child = links[parent].first_child;
+			const uint32_t num_children = links[parent].num_children;
+			if (dirty[parent]) {
+				SimdKernels::multiply(transforms.data() + first_child, global_transforms[parent], global_transforms.data() + first_child, num_children);
+				std::fill_n(dirty.data() + first_child, num_children, 1);
+			}
+			else {
+				for (uint32_t child = first_child; child < first_child + num_children; child++) {
+					if (dirty[child]) {
+						SimdKernels::multiply(transforms.data() + child, global_transforms[parent], global_transforms.data() + child, 1);
+					}
+				}
+			}
+			for (uint32_t child = first_child; child < first_child + num_children; child++) {
+				if (dirty[child]) {
+					mesh_bounds[child] = compute_mesh_bounds(child, global_transforms[child]);
+				}
+			}
 		}
-		return node_data;
+		void merge_changed_bounds(uint32_t node) {
+			bool is_changed = dirty[node];
+			const uint32_t first_child = links[node].first_child;
+			for (uint32_t child = first_child; child < first_child + links[node].num_children; child++) {
+				is_changed |= dirty[child] != 0;
+				dirty[child] = 0;
+			}
+			if (is_changed) {
+				merge_child_bounds(node);
+				dirty[node] = 1;
+			}
+		}
+		void merge_child_bounds(uint32_t node) {
+			bounds[node] = mesh_bounds[node];
+			const uint32_t first_child = links[node].first_child;
+			for (uint32_t child = first_child; child < first_child + links[node].num_children; child++) {
+				bounds[node].expand(bounds[child]);
+			}
+		}
+
+		std::pmr::monotonic_buffer_resource arena;
+		std::pmr::vector<NodeLinks> links;
+		std::pmr::vector<std::pair<uint32_t, uint32_t>> name_ranges; // offset and length in name_chars
+		std::pmr::vector<char> name_chars;
+		std::pmr::vector<glm::mat4> transforms;
+		std::pmr::vector<glm::mat4> global_transforms;
+		std::pmr::vector<uint8_t> dirty;
+		uint32_t first_dirty{ no_node };
+		// world space. mesh_bounds covers a node's meshes, bounds also covers its whole subtree
+		std::pmr::vector<Bounds::AABB> mesh_bounds;
+		std::pmr::vector<Bounds::AABB> bounds;
+		std::pmr::vector<std::shared_ptr<Mesh>> meshes; // handles into Scene::meshes, every node's are contiguous
+		std::pmr::vector<uint32_t> level_offsets; // first node of every depth
+	};
+
+	class NodeRange;
+
+	// a read only view of one node in a NodeStorage, cheap to copy. the storage has to outlive it. transforms are set
+	// on the storage, by whoever owns it
+	class Node {
+	public:
+		Node(const NodeStorage* storage, uint32_t index) : storage(storage), index(index) {}
+
+		uint32_t get_index() const { return index; }
+		std::string_view get_name() const { return storage->get_name(index); }
+		const glm::mat4& get_transform() const { return storage->get_transform(index); }
+		std::span<const std::shared_ptr<Mesh>> get_meshes() const { return storage->get_meshes(index); }
+		std::optional<Node> get_parent() const {
+			const uint32_t parent = storage->get_links(index).parent;
+			return parent == no_node ? std::nullopt : std::optional<Node>(Node(storage, parent));
+		}
+		NodeRange get_children() const;
+		const Bounds::AABB& get_mesh_bounds() const { return storage->get_mesh_bounds(index); }
+		const Bounds::AABB& get_bounds() const { return storage->get_bounds(index); }
+		const glm::mat4& get_global_transform() const { return storage->get_global_transform(index); }
+
+	private:
+		const NodeStorage* storage{};
+		uint32_t index{};
+	};
+	// the children of a node, contiguous in the storage
+	class NodeRange {
+	public:
+		class iterator {
+		public:
+			iterator(const NodeStorage* storage, uint32_t index) : storage(storage), index(index) {}
+			Node operator*() const { return Node(storage, index); }
+			iterator& operator++() { index++; return *this; }
+			bool operator==(const iterator& other) const = default;
+		private:
+			const NodeStorage* storage{};
+			uint32_t index{};
+		};
+
+		NodeRange(const NodeStorage* storage, uint32_t first, uint32_t count) : storage(storage), first(first), count(count) {}
+		iterator begin() const { return iterator(storage, first); }
+		iterator end() const { return iterator(storage, first + count); }
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+		Node operator[](size_t i) const { return Node(storage, first + (uint32_t)i); }
+
+	private:
+		const NodeStorage* storage{};
+		uint32_t first{};
+		uint32_t count{};
+	};
+	NodeRange Node::get_children() const {
+		const auto& links = storage->get_links(index);
+		return NodeRange(storage, links.first_child, links.num_children);
 	}
-	std::unique_ptr<Node> process_node(std::filesystem::path model_dir, const aiScene* scene, const aiNode* parent_node) {
-		auto node_data_result = process_single_node(model_dir, scene, parent_node);
-		// process children recursively
-		for (size_t i = 0; i < parent_node->mNumChildren; i++) {
-			auto node_child = process_node(model_dir, scene, parent_node->mChildren[i]);
-			node_child->parent = node_data_result.get();
-			node_data_result->child_nodes.push_back(std::move(node_child));
+
+	// stable handle of a node. unlike its index it stays the same when Scene::add_node and remove_node rebuild the storage
+	using NodeId = uint32_t;
+
+	// the names below the root joined by '/', the root's path is empty
+	std::string get_node_path(const NodeStorage& nodes, uint32_t node) {
+		std::vector<std::string_view> names{};
+		for (; nodes.get_links(node).parent != no_node; node = nodes.get_links(node).parent) {
+			names.push_back(nodes.get_name(node));
 		}
-		return node_data_result;
+		std::string path{};
+		for (auto it = names.rbegin(); it != names.rend(); it++) {
+			path += it == names.rbegin() ? "" : "/";
+			path += *it;
+		}
+		return path;
 	}
+
+	// hashed lookup of nodes by name and by path. keys that appear more than once resolve to the first node breadth
+	// first, i.e. the shallowest. edits only touch the keys of the added node or the removed subtree, the rebuilt
+	// storage just moves the ids to their new indices
+	class NodeIndex {
+	public:
+		NodeIndex() = default;
+		// the ids start out as the indices
+		explicit NodeIndex(const NodeStorage& nodes) : ids(nodes.size()), indices(nodes.size()) {
+			// paths are built from the parent's, which comes first breadth first
+			std::vector<std::string> paths(nodes.size());
+			name_ids.reserve(nodes.size());
+			path_ids.reserve(nodes.size());
+			for (uint32_t node = 0; node < nodes.size(); node++) {
+				const uint32_t parent = nodes.get_links(node).parent;
+				if (parent != no_node) {
+					paths[node] = paths[parent].empty() ? std::string(nodes.get_name(node)) : paths[parent] + "/" + std::string(nodes.get_name(node));
+				}
+				ids[node] = node;
+				indices[node] = node;
+				name_ids.emplace(nodes.get_name(node), node);
+				path_ids.emplace(paths[node], node);
+			}
+		}
+
+		NodeId get_id(uint32_t node) const { return ids[node]; }
+		// no_node for removed nodes
+		uint32_t get_index(NodeId id) const { return id < indices.size() ? indices[id] : no_node; }
+
+		// no_node when there is none
+		NodeId find_by_name(std::string_view name) const {
+			return find(name_ids, name);
+		}
+		NodeId find_by_path(std::string_view path) const {
+			return find(path_ids, path);
+		}
+		void find_by_name(std::span<const std::string_view> names, std::span<NodeId> out) const {
+			assert(out.size() >= names.size());
+			for (size_t i = 0; i < names.size(); i++) {
+				out[i] = find_by_name(names[i]);
+			}
+		}
+		void find_by_path(std::span<const std::string_view> paths, std::span<NodeId> out) const {
+			assert(out.size() >= paths.size());
+			for (size_t i = 0; i < paths.size(); i++) {
+				out[i] = find_by_path(paths[i]);
+			}
+		}
+
+		// a new child of parent in nodes, the storage before the edit. returns its id, which has no index until remap
+		NodeId insert(const NodeStorage& nodes, uint32_t parent, std::string_view name) {
+			const NodeId id = (NodeId)indices.size();
+			indices.push_back(no_node);
+			const std::string parent_path = get_node_path(nodes, parent);
+			name_ids.emplace(name, id);
+			path_ids.emplace(parent_path.empty() ? std::string(name) : parent_path + "/" + std::string(name), id);
+			return id;
+		}
+		// drops the keys of the subtree of node in nodes, the storage before the edit
+		void erase(const NodeStorage& nodes, uint32_t node) {
+			std::vector<std::pair<uint32_t, std::string>> pending{ { node, get_node_path(nodes, node) } };
+			while (!pending.empty()) {
+				auto [current, path] = std::move(pending.back());
+				pending.pop_back();
+				erase_key(name_ids, nodes.get_name(current), ids[current]);
+				erase_key(path_ids, path, ids[current]);
+				const auto& links = nodes.get_links(current);
+				for (uint32_t child = links.first_child; child < links.first_child + links.num_children; child++) {
+					pending.emplace_back(child, path + "/" + std::string(nodes.get_name(child)));
+				}
+			}
+		}
+		// moves the ids to the indices of the rebuilt storage, new_indices as returned by rebuild_nodes. an added node
+		// is the last entry
+		void remap(std::span<const uint32_t> new_indices, size_t num_nodes, NodeId added_id = no_node) {
+			std::vector<NodeId> new_ids(num_nodes);
+			for (uint32_t node = 0; node < ids.size(); node++) {
+				indices[ids[node]] = new_indices[node];
+				if (new_indices[node] != no_node) {
+					new_ids[new_indices[node]] = ids[node];
+				}
+			}
+			if (added_id != no_node) {
+				indices[added_id] = new_indices.back();
+				new_ids[new_indices.back()] = added_id;
+			}
+			ids = std::move(new_ids);
+		}
+
+	private:
+		struct KeyHash {
+			using is_transparent = void;
+			size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+		};
+		using KeyMap = std::unordered_multimap<std::string, NodeId, KeyHash, std::equal_to<>>;
+
+		NodeId find(const KeyMap& keys, std::string_view key) const {
+			NodeId found = no_node;
+			const auto [first, last] = keys.equal_range(key);
+			for (auto it = first; it != last; it++) {
+				if (found == no_node || indices[it->second] < indices[found]) {
+					found = it->second;
+				}
+			}
+			return found;
+		}
+		static void erase_key(KeyMap& keys, std::string_view key, NodeId id) {
+			const auto [first, last] = keys.equal_range(key);
+			const auto it = std::find_if(first, last, [&](const auto& entry) { return entry.second == id; });
+			if (it != last) {
+				keys.erase(it);
+			}
+		}
+
+		std::vector<NodeId> ids{}; // of every node index
+		std::vector<uint32_t> indices{}; // of every id ever handed out, no_node for removed nodes
+		KeyMap name_ids{};
+		KeyMap path_ids{};
+	};
+
+	struct NewNode {
+		uint32_t parent{};
+		std::string_view name{};
+		glm::mat4 transform{ 1.0f };
+		std::span<const std::shared_ptr<Mesh>> meshes{};
+	};
+	// breadth first copy without the subtree of removed_node, and with added_node as the last child of its parent when
+	// given. the indices behind the change shift, new_indices maps the old ones to the new ones (no_node for removed
+	// nodes) and the added node is the last entry
+	std::unique_ptr<NodeStorage> rebuild_nodes(const NodeStorage& nodes, uint32_t removed_node, const NewNode* added_node, std::vector<uint32_t>& new_indices) {
+		assert(removed_node != 0);
+		std::vector<uint8_t> is_kept(nodes.size());
+		NodeStorageSize size{};
+		for (uint32_t node = 0; node < nodes.size(); node++) {
+			const uint32_t parent = nodes.get_links(node).parent;
+			is_kept[node] = node != removed_node && (parent == no_node || is_kept[parent]);
+			if (is_kept[node]) {
+				size.num_nodes++;
+				size.num_mesh_refs += nodes.get_links(node).num_meshes;
+				size.name_bytes += nodes.get_name(node).size();
+			}
+		}
+		if (added_node) {
+			assert(is_kept[added_node->parent]);
+			size.num_nodes++;
+			size.num_mesh_refs += added_node->meshes.size();
+			size.name_bytes += added_node->name.size();
+		}
+
+		auto rebuilt = std::make_unique<NodeStorage>(size);
+		auto append_node = [&](uint32_t parent, std::string_view name, const glm::mat4& transform, std::span<const std::shared_ptr<Mesh>> meshes) {
+			const uint32_t node = rebuilt->append_node(parent, name, transform);
+			for (const auto& mesh : meshes) {
+				rebuilt->append_mesh(mesh);
+			}
+			return node;
+		};
+		new_indices.assign(nodes.size(), no_node);
+		// the old index of every new node
+		std::vector<uint32_t> sources{ 0 };
+		sources.reserve(size.num_nodes);
+		new_indices[0] = append_node(no_node, nodes.get_name(0), nodes.get_transform(0), nodes.get_meshes(0));
+		for (uint32_t node = 0; node < sources.size(); node++) {
+			const uint32_t source = sources[node];
+			if (source == no_node) {
+				continue;
+			}
+			const auto& links = nodes.get_links(source);
+			for (uint32_t child = links.first_child; child < links.first_child + links.num_children; child++) {
+				if (is_kept[child]) {
+					new_indices[child] = append_node(node, nodes.get_name(child), nodes.get_transform(child), nodes.get_meshes(child));
+					sources.push_back(child);
+				}
+			}
+			if (added_node && added_node->parent == source) {
+				new_indices.push_back(append_node(node, added_node->name, added_node->transform, added_node->meshes));
+				sources.push_back(no_node);
+			}
+		}
+		return rebuilt;
+	}
+
 	bool is_assimp_scene_valid(const aiScene* assimp_scene) {
 		return !(!assimp_scene || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !assimp_scene->mRootNode);
 	}
 	struct Scene {
-		std::unique_ptr<Node> root_node{};
+		std::unique_ptr<NodeStorage> nodes{};
 		std::string name{};
+		std::vector<std::shared_ptr<Mesh>> meshes{};
+		std::vector<std::shared_ptr<Material>> materials{};
+		ImportReport import_report{};
+		GLRenderer::GeometryBuffers geometry_buffers{}; // shared vertex and index buffers of all meshes
+		NodeIndex node_index{};
+
+		Node get_root_node() const {
+			return Node(nodes.get(), 0);
+		}
+		std::optional<Node> get_node(NodeId id) const {
+			const uint32_t node = node_index.get_index(id);
+			return node == no_node ? std::nullopt : std::optional<Node>(Node(nodes.get(), node));
+		}
+		NodeId get_node_id(const Node& node) const {
+			return node_index.get_id(node.get_index());
+		}
+		std::optional<Node> find_node_by_name(std::string_view name) const {
+			return get_node(node_index.find_by_name(name));
+		}
+		std::optional<Node> find_node_by_path(std::string_view path) const {
+			return get_node(node_index.find_by_path(path));
+		}
+		// no_node for the missing ones
+		void find_nodes_by_name(std::span<const std::string_view> names, std::span<NodeId> out) const {
+			node_index.find_by_name(names, out);
+		}
+		void find_nodes_by_path(std::span<const std::string_view> paths, std::span<NodeId> out) const {
+			node_index.find_by_path(paths, out);
+		}
+
+		// adding and removing nodes rebuilds the storage in O(nodes), the hashed index only updates the keys of the
+		// changed nodes. Node views and node indices from before the edit are invalid afterwards, keep NodeIds instead
+		NodeId add_node(NodeId parent, std::string_view name, const glm::mat4& transform, std::span<const std::shared_ptr<Mesh>> node_meshes = {}) {
+			const uint32_t parent_index = node_index.get_index(parent);
+			assert(parent_index != no_node);
+			const NodeId id = node_index.insert(*nodes, parent_index, name);
+			const NewNode added_node{ parent_index, name, transform, node_meshes };
+			std::vector<uint32_t> new_indices{};
+			auto new_nodes = rebuild_nodes(*nodes, no_node, &added_node, new_indices);
+			node_index.remap(new_indices, new_nodes->size(), id);
+			replace_nodes(std::move(new_nodes));
+			return id;
+		}
+		// removes the whole subtree, the root stays
+		void remove_node(NodeId id) {
+			const uint32_t node = node_index.get_index(id);
+			assert(node != no_node && node != 0);
+			node_index.erase(*nodes, node);
+			std::vector<uint32_t> new_indices{};
+			auto new_nodes = rebuild_nodes(*nodes, node, nullptr, new_indices);
+			node_index.remap(new_indices, new_nodes->size());
+			replace_nodes(std::move(new_nodes));
+		}
+
+	private:
+		void replace_nodes(std::unique_ptr<NodeStorage> new_nodes) {
+			new_nodes->update_transforms();
+			nodes = std::move(new_nodes);
+		}
 	};
-	tl::expected<Scene, std::string> build(std::filesystem::path filepath) {
+
+	// a scene is imported and uploaded once and can then be placed any number of times. the asset owns the meshes,
+	// materials and node hierarchy and is shared by all instances. its world matrices and bounds are computed once
+	// here and only read only views are handed out, so no instance can move the nodes under the others
+	class SceneAsset {
+	public:
+		explicit SceneAsset(Scene scene) : scene(std::move(scene)) {
+			this->scene.nodes->update_transforms();
+		}
+
+		const std::string& get_name() const { return scene.name; }
+		Node get_root_node() const { return scene.get_root_node(); }
+		std::optional<Node> get_node(NodeId id) const { return scene.get_node(id); }
+		std::optional<Node> find_node_by_name(std::string_view name) const { return scene.find_node_by_name(name); }
+		std::optional<Node> find_node_by_path(std::string_view path) const { return scene.find_node_by_path(path); }
+
+	private:
+		Scene scene{};
+	};
+
+	// one placement of an asset, all it stores is its own state. the nodes are shared, so there are no per node
+	// overrides: an instance moves, hides or recolors as a whole
+	struct SceneInstance {
+		std::shared_ptr<const SceneAsset> asset{};
+		glm::mat4 root_transform{ 1.0f }; // applied after the asset's global transforms
+		// asset materials replaced on this instance only, most instances leave it empty
+		std::vector<std::pair<const Material*, std::shared_ptr<const Material>>> material_overrides{};
+		bool is_visible{ true };
+
+		glm::mat4 get_global_transform(const Node& node) const {
+			return root_transform * node.get_global_transform();
+		}
+		const Material& get_material(const Mesh& mesh) const {
+			for (const auto& [material, override_material] : material_overrides) {
+				if (material == mesh.material.get()) {
+					return *override_material;
+				}
+			}
+			return *mesh.material;
+		}
+	};
+
+	// frees the gpu data of the meshes no node references anymore and compacts the geometry buffers it fragmented
+	void unload_unused_meshes(Scene& scene) {
+		std::erase_if(scene.meshes, [](const std::shared_ptr<Mesh>& mesh) { return mesh.use_count() == 1; });
+		scene.geometry_buffers.compact_fragmented();
+	}
+	// static batching: the meshes of every node outside the dynamic subtrees are pre-transformed into world space and
+	// merged per material and vertex format. the batches hang off a "static_batches" node below the root, whose
+	// global transform is always identity
+	struct StaticInstance {
+		const aiNode* node{};
+		unsigned int slot{}; // index into aiNode::mMeshes
+		glm::mat4 global_transform{};
+	};
+	using BatchedSlots = std::set<std::pair<const aiNode*, unsigned int>>;
+
+	bool is_dynamic_node(std::string_view name, const BuildOptions& options) {
+		return std::find(options.dynamic_nodes.begin(), options.dynamic_nodes.end(), name) != options.dynamic_nodes.end();
+	}
+	// same product order as Node::get_global_transform, the root's own transform is ignored
+	void collect_static_instances(const aiNode* ai_node, const glm::mat4& global_transform, const BuildOptions& options, std::vector<StaticInstance>& instances) {
+		if (is_dynamic_node(std::string_view(ai_node->mName.data, ai_node->mName.length), options)) {
+			return;
+		}
+		for (unsigned int i = 0; i < ai_node->mNumMeshes; i++) {
+			instances.push_back(StaticInstance{ ai_node, i, global_transform });
+		}
+		for (unsigned int i = 0; i < ai_node->mNumChildren; i++) {
+			const aiNode* child = ai_node->mChildren[i];
+			collect_static_instances(child, assimp_matrix_to_glm_matrix(child->mTransformation) * global_transform, options, instances);
+		}
+	}
+	void count_unbatched_references(const aiNode* ai_node, const BatchedSlots& batched_slots, std::vector<size_t>& references) {
+		for (unsigned int i = 0; i < ai_node->mNumMeshes; i++) {
+			references[ai_node->mMeshes[i]] += !batched_slots.contains({ ai_node, i });
+		}
+		for (unsigned int i = 0; i < ai_node->mNumChildren; i++) {
+			count_unbatched_references(ai_node->mChildren[i], batched_slots, references);
+		}
+	}
+	size_t count_ai_nodes(const aiNode* ai_node, size_t& draw_calls) {
+		size_t num_nodes = 1;
+		draw_calls += ai_node->mNumMeshes;
+		for (unsigned int i = 0; i < ai_node->mNumChildren; i++) {
+			num_nodes += count_ai_nodes(ai_node->mChildren[i], draw_calls);
+		}
+		return num_nodes;
+	}
+
+	// positions by the transform, normals by its inverse transpose. mirroring transforms flip the winding back
+	void append_transformed_mesh(MeshData& batch, const MeshData& mesh_data, const glm::mat4& transform) {
+		const size_t stride = mesh_data.vertex_format.num_floats;
+		const size_t first_vertex = batch.vertices.size() / stride;
+		const glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+		const size_t num_vertices = mesh_data.vertices.size() / stride;
+		batch.vertices.resize(batch.vertices.size() + mesh_data.vertices.size());
+		float* out = batch.vertices.data() + first_vertex * stride;
+		std::copy(mesh_data.vertices.begin(), mesh_data.vertices.end(), out);
+		size_t offset{};
+		for (const auto& attrib : mesh_data.vertex_format.attribs) {
+			if (attrib.type == VertexAttribType::position) {
+				SimdKernels::transform_points(transform, out + offset, num_vertices, stride);
+			}
+			for (size_t v = 0; v < num_vertices && attrib.type == VertexAttribType::normal; v++) {
+				float* p = out + v * stride + offset;
+				glm::vec3 normal = normal_matrix * glm::vec3(p[0], p[1], p[2]);
+				const float length = glm::length(normal);
+				normal = length > 0.0f ? normal / length : normal;
+				p[0] = normal.x;
+				p[1] = normal.y;
+				p[2] = normal.z;
+			}
+			offset += attrib.size;
+		}
+		const bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+		for (size_t i = 0; i + 2 < mesh_data.indices.size(); i += 3) {
+			batch.indices.push_back((unsigned int)first_vertex + mesh_data.indices[i]);
+			batch.indices.push_back((unsigned int)first_vertex + mesh_data.indices[i + (mirrored ? 2 : 1)]);
+			batch.indices.push_back((unsigned int)first_vertex + mesh_data.indices[i + (mirrored ? 1 : 2)]);
+		}
+	}
+
+	// runs on converted mesh data before the import stages, so the batches get optimized like any other mesh.
+	// appends the batches to meshes_data, marks the meshes that lost all their instances as unused and returns
+	// the node mesh slots that were merged. groups with a single instance are left alone
+	BatchedSlots bake_static_batches(const aiScene* ai_scene, std::vector<MeshData>& meshes_data, const BuildOptions& options) {
+		std::vector<StaticInstance> instances{};
+		collect_static_instances(ai_scene->mRootNode, glm::mat4(1.0f), options, instances);
+
+		struct BatchGroup {
+			unsigned int material_index{};
+			const VertexAttrib* vertex_attribs{}; // every layout has its own static attribute table
+			std::vector<StaticInstance> instances{};
+		};
+		std::vector<BatchGroup> groups{};
+		for (const auto& instance : instances) {
+			const auto& mesh_data = meshes_data[instance.node->mMeshes[instance.slot]];
+			if (!mesh_data.is_triangle_list) {
+				continue;
+			}
+			auto it = std::find_if(groups.begin(), groups.end(), [&](const BatchGroup& group) {
+				return group.material_index == mesh_data.material_index && group.vertex_attribs == mesh_data.vertex_format.attribs.data();
+			});
+			if (it == groups.end()) {
+				groups.push_back(BatchGroup{ mesh_data.material_index, mesh_data.vertex_format.attribs.data() });
+				it = std::prev(groups.end());
+			}
+			it->instances.push_back(instance);
+		}
+
+		BatchedSlots batched_slots{};
+		std::vector<MeshData> batches{};
+		for (const auto& group : groups) {
+			if (group.instances.size() < 2) {
+				continue;
+			}
+			const auto& first_mesh = meshes_data[group.instances[0].node->mMeshes[group.instances[0].slot]];
+			MeshData batch{};
+			batch.vertex_format = first_mesh.vertex_format;
+			batch.material_index = group.material_index;
+			batch.stats.name = "static batch " + std::to_string(batches.size());
+			for (const auto& instance : group.instances) {
+				append_transformed_mesh(batch, meshes_data[instance.node->mMeshes[instance.slot]], instance.global_transform);
+				batched_slots.insert({ instance.node, instance.slot });
+			}
+			batch.stats.num_vertices = batch.vertices.size() / batch.vertex_format.num_floats;
+			batch.stats.num_indices = batch.indices.size();
+			batches.push_back(std::move(batch));
+		}
+
+		std::vector<size_t> references(meshes_data.size());
+		count_unbatched_references(ai_scene->mRootNode, batched_slots, references);
+		for (size_t i = 0; i < meshes_data.size(); i++) {
+			meshes_data[i].is_used = references[i] > 0;
+		}
+		meshes_data.insert(meshes_data.end(), std::make_move_iterator(batches.begin()), std::make_move_iterator(batches.end()));
+		return batched_slots;
+	}
+
+	void measure_ai_nodes(const aiNode* ai_node, NodeStorageSize& size) {
+		size.num_nodes++;
+		size.num_mesh_refs += ai_node->mNumMeshes;
+		size.name_bytes += ai_node->mName.length;
+		for (unsigned int i = 0; i < ai_node->mNumChildren; i++) {
+			measure_ai_nodes(ai_node->mChildren[i], size);
+		}
+	}
+	// breadth first copy of the assimp hierarchy without the batched mesh slots. the static batches get their own
+	// node as the root's last child
+	std::unique_ptr<NodeStorage> process_nodes(const std::vector<std::shared_ptr<Mesh>>& scene_meshes, const aiNode* ai_root, const BatchedSlots& batched_slots, std::span<const std::shared_ptr<Mesh>> batch_meshes) {
+		constexpr std::string_view batch_node_name = "static_batches";
+		NodeStorageSize size{};
+		measure_ai_nodes(ai_root, size);
+		if (!batch_meshes.empty()) {
+			size.num_nodes++;
+			size.num_mesh_refs += batch_meshes.size();
+			size.name_bytes += batch_node_name.size();
+		}
+		auto nodes = std::make_unique<NodeStorage>(size);
+		auto append_ai_node = [&](uint32_t parent, const aiNode* ai_node) {
+			nodes->append_node(parent, std::string_view(ai_node->mName.data, ai_node->mName.length), assimp_matrix_to_glm_matrix(ai_node->mTransformation));
+			for (unsigned int i = 0; i < ai_node->mNumMeshes; i++) {
+				if (!batched_slots.contains({ ai_node, i })) {
+					nodes->append_mesh(scene_meshes[ai_node->mMeshes[i]]);
+				}
+			}
+		};
+		// the assimp node of every storage node, null for the batch node
+		std::vector<const aiNode*> ai_nodes{ ai_root };
+		ai_nodes.reserve(size.num_nodes);
+		append_ai_node(no_node, ai_root);
+		for (uint32_t node = 0; node < ai_nodes.size(); node++) {
+			const aiNode* ai_node = ai_nodes[node];
+			if (!ai_node) {
+				continue;
+			}
+			for (unsigned int i = 0; i < ai_node->mNumChildren; i++) {
+				append_ai_node(node, ai_node->mChildren[i]);
+				ai_nodes.push_back(ai_node->mChildren[i]);
+			}
+			if (node == 0 && !batch_meshes.empty()) {
+				nodes->append_node(node, batch_node_name, glm::mat4(1.0f));
+				for (const auto& mesh : batch_meshes) {
+					nodes->append_mesh(mesh);
+				}
+				ai_nodes.push_back(nullptr);
+			}
+		}
+		return nodes;
+	}
+	// drops empty leaves and replaces empty nodes that have a single child by that child. dynamic nodes stay.
+	// the result is a new storage, still breadth first
+	std::unique_ptr<NodeStorage> collapse_empty_nodes(const NodeStorage& nodes, const BuildOptions& options) {
+		// bottom up, what every node turns into: itself, no_node when dropped, or the single kept node below it
+		std::vector<uint32_t> targets(nodes.size());
+		NodeStorageSize size{};
+		for (uint32_t node = (uint32_t)nodes.size(); node-- > 0;) {
+			const auto& links = nodes.get_links(node);
+			uint32_t num_kept{};
+			uint32_t kept_target = no_node;
+			for (uint32_t child = links.first_child; child < links.first_child + links.num_children; child++) {
+				if (targets[child] != no_node) {
+					num_kept++;
+					kept_target = targets[child];
+				}
+			}
+			const bool is_kept = node == 0 || is_dynamic_node(nodes.get_name(node), options) || links.num_meshes > 0 || num_kept > 1;
+			targets[node] = is_kept ? node : num_kept == 1 ? kept_target : no_node;
+			if (is_kept) {
+				size.num_nodes++;
+				size.num_mesh_refs += links.num_meshes;
+				size.name_bytes += nodes.get_name(node).size();
+			}
+		}
+
+		auto collapsed = std::make_unique<NodeStorage>(size);
+		auto append_copy = [&](uint32_t parent, uint32_t node, const glm::mat4& transform) {
+			collapsed->append_node(parent, nodes.get_name(node), transform);
+			for (const auto& mesh : nodes.get_meshes(node)) {
+				collapsed->append_mesh(mesh);
+			}
+		};
+		// the old index of every new node
+		std::vector<uint32_t> sources{ 0 };
+		sources.reserve(size.num_nodes);
+		append_copy(no_node, 0, nodes.get_transform(0));
+		for (uint32_t node = 0; node < sources.size(); node++) {
+			const auto& links = nodes.get_links(sources[node]);
+			for (uint32_t child = links.first_child; child < links.first_child + links.num_children; child++) {
+				const uint32_t target = targets[child];
+				if (target == no_node) {
+					continue;
+				}
+				// the target's global transform has to stay the same, so it takes over the transforms of the
+				// collapsed nodes between it and the child
+				glm::mat4 transform = nodes.get_transform(target);
+				for (uint32_t ancestor = target; ancestor != child;) {
+					ancestor = nodes.get_links(ancestor).parent;
+					transform = transform * nodes.get_transform(ancestor);
+				}
+				append_copy(node, target, transform);
+				sources.push_back(target);
+			}
+		}
+		return collapsed;
+	}
+
+	tl::expected<Scene, std::string> build(std::filesystem::path filepath, const BuildOptions& options = {}) {
 		Assimp::Importer assimp_importer{};
 		const aiScene* assimp_scene = assimp_importer.ReadFile(filepath.string().c_str(), aiProcess_Triangulate | aiProcess_FlipUVs);
 		if (!is_assimp_scene_valid(assimp_scene)) {
 			return tl::unexpected{ std::string{assimp_importer.GetErrorString()} };
 		}
 		std::filesystem::path model_dir = filepath.parent_path();
-		auto root_node = process_node(model_dir, assimp_scene, assimp_scene->mRootNode);
+
+		// cpu stage: convert all meshes, optionally bake the static batches out of them, then decode textures and
+		// run the import stages on the thread pool
+		std::vector<MeshData> meshes_data(assimp_scene->mNumMeshes);
+		ThreadPool::get().parallel_for(meshes_data.size(), [&](size_t i) {
+			meshes_data[i] = convert_mesh_data(assimp_scene->mMeshes[i]);
+		});
+		BatchedSlots batched_slots{};
+		StaticBatchStats static_batch_stats{};
+		if (options.bake_static_batches) {
+			static_batch_stats.nodes_before = count_ai_nodes(assimp_scene->mRootNode, static_batch_stats.draw_calls_before);
+			batched_slots = bake_static_batches(assimp_scene, meshes_data, options);
+			static_batch_stats.num_batches = meshes_data.size() - assimp_scene->mNumMeshes;
+		}
+		auto texture_paths = get_all_texture_paths(model_dir, assimp_scene);
+		std::vector<TextureCache::PendingTexture> pending_textures(texture_paths.size());
+		ThreadPool::get().parallel_for(texture_paths.size() + meshes_data.size(), [&](size_t i) {
+			if (i < texture_paths.size()) {
+				pending_textures[i] = TextureCache::get().load(texture_paths[i]);
+			}
+			else if (meshes_data[i - texture_paths.size()].is_used) {
+				finish_mesh_data(meshes_data[i - texture_paths.size()], options);
+			}
+		});
+
+		// upload stage: drain the results on the thread owning the gl context
+		TextureTable textures{};
+		for (size_t i = 0; i < texture_paths.size(); i++) {
+			textures[texture_paths[i].string()] = TextureCache::get().resolve(std::move(pending_textures[i]));
+		}
+		auto materials = process_materials(model_dir, textures, assimp_scene);
+		GLRenderer::GeometryBuffers geometry_buffers{};
+		auto meshes = upload_meshes(meshes_data, materials, geometry_buffers);
+		const auto batch_meshes = std::span<const std::shared_ptr<Mesh>>(meshes).subspan(assimp_scene->mNumMeshes);
+		auto nodes = process_nodes(meshes, assimp_scene->mRootNode, batched_slots, batch_meshes);
+		if (options.bake_static_batches) {
+			nodes = collapse_empty_nodes(*nodes, options);
+			static_batch_stats.nodes_after = nodes->size();
+			static_batch_stats.draw_calls_after = nodes->get_num_mesh_refs();
+		}
 		std::string scene_name = std::string(assimp_scene->mName.data, assimp_scene->mName.length);
-		return Scene{ std::move(root_node), scene_name };
+
+		// meshes that were merged away entirely never got uploaded
+		std::erase(meshes, nullptr);
+		ImportReport import_report{};
+		import_report.vertex_kernel_name = VertexStream::get_kernel_name();
+		import_report.static_batching = static_batch_stats;
+		for (auto& mesh_data : meshes_data) {
+			if (mesh_data.is_used) {
+				import_report.meshes.push_back(std::move(mesh_data.stats));
+			}
+		}
+		nodes->update_transforms();
+		NodeIndex node_index(*nodes);
+		return Scene{ std::move(nodes), scene_name, std::move(meshes), std::move(materials), std::move(import_report), std::move(geometry_buffers), std::move(node_index) };
 	}
 }
\ No newline at end of file
@@ -0,0 +1,536 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <bit>
+
+#include <glm/glm.hpp>
+
+#include "utils.h"
+
+// cpu side index/vertex buffer optimizations run at import. all of them work on triangle lists
+namespace MeshOptimizer {
+
+	constexpr size_t vertex_cache_size = 32;
+
+	// average cache miss ratio: post transform cache misses (vertex shader invocations) per triangle for a fifo
+	// cache of the given size. 0.5 is the best case for a regular grid, 3.0 means the cache never hits
+	float compute_acmr(std::span<const unsigned int> indices, size_t num_vertices, size_t cache_size = vertex_cache_size) {
+		const size_t num_triangles = indices.size() / 3;
+		if (num_triangles == 0) {
+			return 0.0f;
+		}
+		// a vertex is in the fifo if it was inserted less than cache_size insertions ago
+		std::vector<size_t> insert_times(num_vertices, 0);
+		size_t time = cache_size + 1;
+		size_t num_misses{};
+		for (auto index : indices) {
+			if (time - insert_times[index] > cache_size) {
+				insert_times[index] = time++;
+				num_misses++;
+			}
+		}
+		return (float)num_misses / (float)num_triangles;
+	}
+
+	namespace Forsyth {
+		constexpr float cache_decay_power = 1.5f;
+		constexpr float last_triangle_score = 0.75f;
+		constexpr float valence_boost_scale = 2.0f;
+		constexpr float valence_boost_power = 0.5f;
+		constexpr size_t max_valence_table_size = 32;
+
+		struct ScoreTables {
+			std::array<float, vertex_cache_size> cache{};
+			std::array<float, max_valence_table_size> valence{};
+		};
+		const ScoreTables& get_score_tables() {
+			static const ScoreTables tables = []() {
+				ScoreTables tables{};
+				for (size_t i = 0; i < vertex_cache_size; i++) {
+					if (i < 3) {
+						// the vertices of the last triangle get a fixed score so it isn't reused right away
+						tables.cache[i] = last_triangle_score;
+					}
+					else {
+						const float scaler = 1.0f / (vertex_cache_size - 3);
+						tables.cache[i] = std::pow(1.0f - (i - 3) * scaler, cache_decay_power);
+					}
+				}
+				for (size_t i = 0; i < max_valence_table_size; i++) {
+					tables.valence[i] = valence_boost_scale * std::pow((float)i, -valence_boost_power);
+				}
+				return tables;
+			}();
+			return tables;
+		}
+		float get_vertex_score(int cache_position, unsigned int num_live_triangles) {
+			if (num_live_triangles == 0) {
+				return -1.0f;
+			}
+			const auto& tables = get_score_tables();
+			float score = cache_position < 0 ? 0.0f : tables.cache[cache_position];
+			// boost vertices with few triangles left so lone triangles get finished off instead of left behind
+			score += num_live_triangles < max_valence_table_size ? tables.valence[num_live_triangles] : valence_boost_scale * std::pow((float)num_live_triangles, -valence_boost_power);
+			return score;
+		}
+	}
+
+	// reorders the triangles for post transform vertex cache locality using tom forsyth's
+	// "linear-speed vertex cache optimisation". the vertex buffer is left untouched
+	std::vector<unsigned int> optimize_vertex_cache(std::span<const unsigned int> indices, size_t num_vertices) {
+		const size_t num_triangles = indices.size() / 3;
+		if (num_triangles == 0) {
+			return std::vector<unsigned int>(indices.begin(), indices.end());
+		}
+
+		// vertex -> triangle adjacency, compacted per vertex as triangles get emitted
+		std::vector<unsigned int> num_live_triangles(num_vertices, 0);
+		for (auto index : indices) {
+			num_live_triangles[index]++;
+		}
+		std::vector<size_t> adjacency_offsets(num_vertices + 1, 0);
+		for (size_t v = 0; v < num_vertices; v++) {
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + num_live_triangles[v];
+		}
+		std::vector<unsigned int> adjacency(indices.size());
+		{
+			std::vector<size_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++) {
+				adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+			}
+		}
+
+		std::vector<int> cache_positions(num_vertices, -1);
+		std::vector<float> vertex_scores(num_vertices);
+		for (size_t v = 0; v < num_vertices; v++) {
+			vertex_scores[v] = Forsyth::get_vertex_score(-1, num_live_triangles[v]);
+		}
+		std::vector<float> triangle_scores(num_triangles);
+		for (size_t t = 0; t < num_triangles; t++) {
+			triangle_scores[t] = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+		}
+		std::vector<bool> emitted(num_triangles, false);
+
+		std::vector<unsigned int> result{};
+		result.reserve(indices.size());
+
+		std::array<unsigned int, vertex_cache_size + 3> cache{};
+		std::array<unsigned int, vertex_cache_size + 3> new_cache{};
+		size_t cache_count{};
+
+		size_t input_cursor{};
+		long long best_triangle = 0;
+		for (size_t t = 1; t < num_triangles; t++) {
+			if (triangle_scores[t] > triangle_scores[best_triangle]) {
+				best_triangle = t;
+			}
+		}
+
+		while (best_triangle >= 0) {
+			const size_t triangle = (size_t)best_triangle;
+			emitted[triangle] = true;
+			const unsigned int* triangle_vertices = &indices[triangle * 3];
+			result.insert(result.end(), triangle_vertices, triangle_vertices + 3);
+
+			// the emitted triangle goes to the front of the lru cache, the rest shifts back
+			size_t new_cache_count{};
+			for (size_t k = 0; k < 3; k++) {
+				const unsigned int v = triangle_vertices[k];
+				new_cache[new_cache_count++] = v;
+				// remove the triangle from the vertex adjacency
+				auto begin = adjacency.begin() + adjacency_offsets[v];
+				auto end = begin + num_live_triangles[v];
+				auto it = std::find(begin, end, (unsigned int)triangle);
+				std::iter_swap(it, end - 1);
+				num_live_triangles[v]--;
+			}
+			for (size_t k = 0; k < cache_count; k++) {
+				const unsigned int v = cache[k];
+				if (v != triangle_vertices[0] && v != triangle_vertices[1] && v != triangle_vertices[2]) {
+					new_cache[new_cache_count++] = v;
+				}
+			}
+			std::swap(cache, new_cache);
+			cache_count = new_cache_count;
+
+			// rescore everything that is or just was in the cache and pick the best triangle touching it
+			best_triangle = -1;
+			float best_score = -1.0f;
+			for (size_t k = 0; k < cache_count; k++) {
+				const unsigned int v = cache[k];
+				cache_positions[v] = k < vertex_cache_size ? (int)k : -1;
+				vertex_scores[v] = Forsyth::get_vertex_score(cache_positions[v], num_live_triangles[v]);
+			}
+			for (size_t k = 0; k < cache_count; k++) {
+				const unsigned int v = cache[k];
+				for (size_t a = 0; a < num_live_triangles[v]; a++) {
+					const unsigned int t = adjacency[adjacency_offsets[v] + a];
+					const float score = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+					triangle_scores[t] = score;
+					if (score > best_score) {
+						best_score = score;
+						best_triangle = t;
+					}
+				}
+			}
+			cache_count = std::min(cache_count, vertex_cache_size);
+
+			// nothing in the cache has triangles left, continue with the next unemitted triangle in input order
+			if (best_triangle < 0) {
+				while (input_cursor < num_triangles && emitted[input_cursor]) {
+					input_cursor++;
+				}
+				if (input_cursor < num_triangles) {
+					best_triangle = input_cursor;
+				}
+			}
+		}
+		return result;
+	}
+
+	// triangle indices where a new cluster starts: a triangle whose 3 vertices all miss the cache usually starts
+	// a new patch of the mesh that is disjoint from the previous triangles
+	std::vector<size_t> get_hard_cluster_boundaries(std::span<const unsigned int> indices, size_t num_vertices) {
+		std::vector<size_t> boundaries{};
+		std::vector<size_t> insert_times(num_vertices, 0);
+		size_t time = vertex_cache_size + 1;
+		for (size_t t = 0; t < indices.size() / 3; t++) {
+			size_t num_misses{};
+			for (size_t k = 0; k < 3; k++) {
+				const unsigned int index = indices[t * 3 + k];
+				if (time - insert_times[index] > vertex_cache_size) {
+					insert_times[index] = time++;
+					num_misses++;
+				}
+			}
+			if (t == 0 || num_misses == 3) {
+				boundaries.push_back(t);
+			}
+		}
+		return boundaries;
+	}
+
+	// splits every hard cluster further wherever the acmr of the triangles since the last split is already within
+	// threshold times the acmr of the whole hard cluster. flushing the cache at those points costs at most that much
+	std::vector<size_t> get_soft_cluster_boundaries(std::span<const unsigned int> indices, size_t num_vertices, const std::vector<size_t>& hard_boundaries, float threshold) {
+		const size_t num_triangles = indices.size() / 3;
+		std::vector<size_t> boundaries{};
+		std::vector<size_t> insert_times(num_vertices, 0);
+		size_t time = vertex_cache_size + 1;
+		auto count_misses = [&](size_t t) {
+			size_t num_misses{};
+			for (size_t k = 0; k < 3; k++) {
+				const unsigned int index = indices[t * 3 + k];
+				if (time - insert_times[index] > vertex_cache_size) {
+					insert_times[index] = time++;
+					num_misses++;
+				}
+			}
+			return num_misses;
+		};
+		auto flush_cache = [&]() { time += vertex_cache_size + 1; };
+
+		for (size_t c = 0; c < hard_boundaries.size(); c++) {
+			const size_t start = hard_boundaries[c];
+			const size_t end = c + 1 < hard_boundaries.size() ? hard_boundaries[c + 1] : num_triangles;
+
+			flush_cache();
+			size_t cluster_misses{};
+			for (size_t t = start; t < end; t++) {
+				cluster_misses += count_misses(t);
+			}
+			const float cluster_threshold = threshold * (float)cluster_misses / (float)(end - start);
+
+			boundaries.push_back(start);
+			flush_cache();
+			size_t running_misses{};
+			size_t running_triangles{};
+			for (size_t t = start; t < end; t++) {
+				running_misses += count_misses(t);
+				running_triangles++;
+				if ((float)running_misses / (float)running_triangles <= cluster_threshold && t + 1 < end) {
+					boundaries.push_back(t + 1);
+					flush_cache();
+					running_misses = 0;
+					running_triangles = 0;
+				}
+			}
+		}
+		return boundaries;
+	}
+
+	// positions are the first 3 floats of every vertex in an interleaved buffer with vertex_stride floats per vertex
+	struct PositionStream {
+		const float* vertices{};
+		size_t num_vertices{};
+		size_t vertex_stride{};
+
+		glm::vec3 get(size_t i) const {
+			const float* p = vertices + i * vertex_stride;
+			return glm::vec3(p[0], p[1], p[2]);
+		}
+	};
+
+	// reorders the clusters of a vertex cache optimized index buffer so triangles likely to occlude the rest are
+	// drawn first (sander et al. "fast triangle reordering for vertex locality and reduced overdraw").
+	// threshold bounds the acmr increase, 1.05 allows the vertex cache efficiency to drop by up to 5%
+	std::vector<unsigned int> optimize_overdraw(std::span<const unsigned int> indices, const PositionStream& positions, float threshold) {
+		const size_t num_triangles = indices.size() / 3;
+		if (num_triangles == 0) {
+			return std::vector<unsigned int>(indices.begin(), indices.end());
+		}
+		auto hard_boundaries = get_hard_cluster_boundaries(indices, positions.num_vertices);
+		auto boundaries = get_soft_cluster_boundaries(indices, positions.num_vertices, hard_boundaries, threshold);
+
+		glm::vec3 mesh_centroid(0.0f);
+		float mesh_area{};
+		struct Cluster {
+			size_t start{};
+			size_t end{};
+			float sort_key{};
+		};
+		std::vector<Cluster> clusters(boundaries.size());
+		std::vector<glm::vec3> cluster_centroids(boundaries.size(), glm::vec3(0.0f));
+		std::vector<glm::vec3> cluster_normals(boundaries.size(), glm::vec3(0.0f));
+		for (size_t c = 0; c < boundaries.size(); c++) {
+			clusters[c].start = boundaries[c];
+			clusters[c].end = c + 1 < boundaries.size() ? boundaries[c + 1] : num_triangles;
+			float cluster_area{};
+			for (size_t t = clusters[c].start; t < clusters[c].end; t++) {
+				const glm::vec3 p0 = positions.get(indices[t * 3 + 0]);
+				const glm::vec3 p1 = positions.get(indices[t * 3 + 1]);
+				const glm::vec3 p2 = positions.get(indices[t * 3 + 2]);
+				const glm::vec3 area_normal = glm::cross(p1 - p0, p2 - p0); // length is twice the triangle area
+				const float area = glm::length(area_normal);
+				const glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+				cluster_centroids[c] += centroid * area;
+				cluster_normals[c] += area_normal;
+				cluster_area += area;
+			}
+			mesh_centroid += cluster_centroids[c];
+			mesh_area += cluster_area;
+			cluster_centroids[c] = cluster_area > 0.0f ? cluster_centroids[c] / cluster_area : positions.get(indices[clusters[c].start * 3]);
+		}
+		mesh_centroid = mesh_area > 0.0f ? mesh_centroid / mesh_area : glm::vec3(0.0f);
+
+		// clusters facing away from the mesh center are on the outside, they occlude the inner ones from most directions
+		for (size_t c = 0; c < clusters.size(); c++) {
+			const float normal_length = glm::length(cluster_normals[c]);
+			const glm::vec3 normal = normal_length > 0.0f ? cluster_normals[c] / normal_length : glm::vec3(0.0f);
+			clusters[c].sort_key = glm::dot(cluster_centroids[c] - mesh_centroid, normal);
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+		std::vector<unsigned int> result{};
+		result.reserve(indices.size());
+		for (const auto& cluster : clusters) {
+			result.insert(result.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+		}
+		return result;
+	}
+
+	struct OverdrawStats {
+		size_t pixels_covered{};
+		size_t pixels_shaded{};
+		float overdraw{}; // shaded / covered, 1.0 means every covered pixel was shaded exactly once
+	};
+
+	// cpu estimate of the overdraw caused by the triangle order. the mesh is rasterized with a depth test and no
+	// culling from the 6 axis and 8 diagonal directions, with orthographic projections fitted to the mesh
+	OverdrawStats analyze_overdraw(std::span<const unsigned int> indices, const PositionStream& positions) {
+		constexpr int grid_size = 256;
+		const glm::vec3 view_directions[] = {
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+			{ 1, 1, 1 }, { 1, 1, -1 }, { 1, -1, 1 }, { 1, -1, -1 }, { -1, 1, 1 }, { -1, 1, -1 }, { -1, -1, 1 }, { -1, -1, -1 },
+		};
+		OverdrawStats stats{};
+		if (indices.size() < 3) {
+			return stats;
+		}
+		std::vector<glm::vec3> projected(positions.num_vertices);
+		std::vector<float> depth_buffer(grid_size * grid_size);
+		for (auto view_direction : view_directions) {
+			const glm::vec3 forward = glm::normalize(view_direction);
+			const glm::vec3 helper = std::abs(forward.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+			const glm::vec3 right = glm::normalize(glm::cross(helper, forward));
+			const glm::vec3 up = glm::cross(forward, right);
+
+			glm::vec3 min_corner(std::numeric_limits<float>::max());
+			glm::vec3 max_corner(std::numeric_limits<float>::lowest());
+			for (size_t i = 0; i < positions.num_vertices; i++) {
+				const glm::vec3 p = positions.get(i);
+				projected[i] = glm::vec3(glm::dot(p, right), glm::dot(p, up), glm::dot(p, forward));
+				min_corner = glm::min(min_corner, projected[i]);
+				max_corner = glm::max(max_corner, projected[i]);
+			}
+			const float extent = std::max(max_corner.x - min_corner.x, max_corner.y - min_corner.y);
+			const float scale = extent > 0.0f ? (grid_size - 1) / extent : 0.0f;
+			for (auto& p : projected) {
+				p.x = (p.x - min_corner.x) * scale;
+				p.y = (p.y - min_corner.y) * scale;
+			}
+
+			std::fill(depth_buffer.begin(), depth_buffer.end(), std::numeric_limits<float>::max());
+			for (size_t t = 0; t < indices.size() / 3; t++) {
+				const glm::vec3 a = projected[indices[t * 3 + 0]];
+				glm::vec3 b = projected[indices[t * 3 + 1]];
+				glm::vec3 c = projected[indices[t * 3 + 2]];
+				float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+				if (area == 0.0f) {
+					continue;
+				}
+				if (area < 0.0f) {
+					std::swap(b, c);
+					area = -area;
+				}
+				const int min_x = std::max(0, (int)std::ceil(std::min({ a.x, b.x, c.x }) - 0.5f));
+				const int max_x = std::min(grid_size - 1, (int)std::floor(std::max({ a.x, b.x, c.x }) - 0.5f));
+				const int min_y = std::max(0, (int)std::ceil(std::min({ a.y, b.y, c.y }) - 0.5f));
+				const int max_y = std::min(grid_size - 1, (int)std::floor(std::max({ a.y, b.y, c.y }) - 0.5f));
+				for (int y = min_y; y <= max_y; y++) {
+					for (int x = min_x; x <= max_x; x++) {
+						const float px = x + 0.5f;
+						const float py = y + 0.5f;
+						const float w_a = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+						const float w_b = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+						const float w_c = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+						if (w_a < 0.0f || w_b < 0.0f || w_c < 0.0f) {
+							continue;
+						}
+						const float depth = (w_a * a.z + w_b * b.z + w_c * c.z) / area;
+						float& stored_depth = depth_buffer[y * grid_size + x];
+						if (depth < stored_depth) {
+							if (stored_depth == std::numeric_limits<float>::max()) {
+								stats.pixels_covered++;
+							}
+							stored_depth = depth;
+							stats.pixels_shaded++;
+						}
+					}
+				}
+			}
+		}
+		stats.overdraw = stats.pixels_covered > 0 ? (float)stats.pixels_shaded / (float)stats.pixels_covered : 0.0f;
+		return stats;
+	}
+
+	// renumbers the vertices in the order the index buffer first uses them and drops the unreferenced ones, so the
+	// vertex fetch walks the buffer linearly. vertices is interleaved with vertex_stride floats per vertex
+	void optimize_vertex_fetch(std::vector<unsigned int>& indices, std::vector<float>& vertices, size_t vertex_stride) {
+		constexpr unsigned int unused = ~0u;
+		const size_t num_vertices = vertices.size() / vertex_stride;
+		std::vector<unsigned int> remap(num_vertices, unused);
+		unsigned int num_used_vertices{};
+		for (auto& index : indices) {
+			if (remap[index] == unused) {
+				remap[index] = num_used_vertices++;
+			}
+			index = remap[index];
+		}
+		std::vector<float> reordered_vertices(num_used_vertices * vertex_stride);
+		for (size_t v = 0; v < num_vertices; v++) {
+			if (remap[v] != unused) {
+				std::copy_n(vertices.begin() + v * vertex_stride, vertex_stride, reordered_vertices.begin() + remap[v] * vertex_stride);
+			}
+		}
+		vertices = std::move(reordered_vertices);
+	}
+
+	// overfetch: bytes pulled into a simulated 16 KiB fifo cache of 64 byte lines, divided by the size of the
+	// referenced vertices. 1.0 means every referenced byte is fetched exactly once
+	float analyze_vertex_fetch(std::span<const unsigned int> indices, size_t num_vertices, size_t vertex_size) {
+		constexpr size_t cache_line_size = 64;
+		constexpr size_t num_cache_lines = 16 * 1024 / cache_line_size;
+		if (indices.empty() || vertex_size == 0) {
+			return 0.0f;
+		}
+		const size_t num_lines = (num_vertices * vertex_size + cache_line_size - 1) / cache_line_size;
+		std::vector<size_t> insert_times(num_lines, 0);
+		std::vector<bool> is_referenced(num_vertices, false);
+		size_t time = num_cache_lines + 1;
+		size_t bytes_fetched{};
+		size_t bytes_referenced{};
+		for (auto index : indices) {
+			if (!is_referenced[index]) {
+				is_referenced[index] = true;
+				bytes_referenced += vertex_size;
+			}
+			const size_t first_line = index * vertex_size / cache_line_size;
+			const size_t last_line = ((index + 1) * vertex_size - 1) / cache_line_size;
+			for (size_t line = first_line; line <= last_line; line++) {
+				if (time - insert_times[line] > num_cache_lines) {
+					insert_times[line] = time++;
+					bytes_fetched += cache_line_size;
+				}
+			}
+		}
+		return (float)bytes_fetched / (float)bytes_referenced;
+	}
+
+	// merges vertices whose interleaved floats are identical, or fall into the same epsilon sized quantization
+	// bucket when epsilon is above 0, and rebuilds the index buffer. the first vertex of each group is kept
+	void weld_vertices(std::vector<unsigned int>& indices, std::vector<float>& vertices, size_t vertex_stride, float epsilon) {
+		const size_t num_vertices = vertices.size() / vertex_stride;
+		if (num_vertices == 0) {
+			return;
+		}
+		// vertex keys are either the raw float bits or the quantized values, both compared as 64 bit words. buckets
+		// that don't fit the key range, and nan or inf, keep their raw bits offset below every bucket so they only
+		// merge with the exact same float
+		constexpr float max_bucket = 4.0e18f;
+		auto get_raw_key = [](float value) {
+			return std::numeric_limits<int64_t>::min() + (int64_t)std::bit_cast<uint32_t>(value);
+		};
+		std::vector<int64_t> keys(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			keys[i] = get_raw_key(vertices[i]);
+			if (epsilon > 0.0f) {
+				const float bucket = std::floor(vertices[i] / epsilon + 0.5f);
+				if (std::abs(bucket) < max_bucket) {
+					keys[i] = (int64_t)bucket;
+				}
+			}
+		}
+		auto get_key = [&](size_t v) {
+			return std::span<const int64_t>(keys.data() + v * vertex_stride, vertex_stride);
+		};
+
+		// open addressing table of vertex indices, at most half full
+		constexpr unsigned int empty = ~0u;
+		size_t table_size = 1;
+		while (table_size < num_vertices * 2) {
+			table_size *= 2;
+		}
+		std::vector<unsigned int> table(table_size, empty);
+		std::vector<unsigned int> remap(num_vertices);
+		unsigned int num_unique_vertices{};
+		for (size_t v = 0; v < num_vertices; v++) {
+			const auto key = get_key(v);
+			const auto key_bytes = std::as_bytes(key);
+			size_t slot = GLUtils::hash_bytes(std::span<const unsigned char>((const unsigned char*)key_bytes.data(), key_bytes.size())) & (table_size - 1);
+			while (table[slot] != empty && !std::equal(key.begin(), key.end(), get_key(table[slot]).begin())) {
+				slot = (slot + 1) & (table_size - 1);
+			}
+			if (table[slot] == empty) {
+				table[slot] = (unsigned int)v;
+				// unique vertices are compacted in place, a vertex never moves to a higher index
+				std::copy_n(vertices.begin() + v * vertex_stride, vertex_stride, vertices.begin() + num_unique_vertices * vertex_stride);
+				remap[v] = num_unique_vertices++;
+			}
+			else {
+				remap[v] = remap[table[slot]];
+			}
+		}
+		vertices.resize(num_unique_vertices * vertex_stride);
+		for (auto& index : indices) {
+			index = remap[index];
+		}
+	}
+}
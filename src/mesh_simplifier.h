@@ -0,0 +1,285 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.h"
+
+// quadric error metric simplification by half edge collapse. vertices only collapse onto existing vertices, so the
+// simplified index buffers share the vertex buffer and keep its attributes
+namespace MeshSimplifier {
+
+	// sum of squared distances to a set of area weighted planes
+	struct Quadric {
+		double a00{}, a01{}, a02{}, a11{}, a12{}, a22{};
+		double b0{}, b1{}, b2{};
+		double c{};
+		double weight{};
+
+		void add_plane(const glm::vec3& n, float d, float w) {
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+			b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+			c += w * d * d;
+			weight += w;
+		}
+		Quadric& operator+=(const Quadric& rhs) {
+			a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02; a11 += rhs.a11; a12 += rhs.a12; a22 += rhs.a22;
+			b0 += rhs.b0; b1 += rhs.b1; b2 += rhs.b2;
+			c += rhs.c;
+			weight += rhs.weight;
+			return *this;
+		}
+		// mean squared distance of p to the planes
+		double evaluate(const glm::vec3& p) const {
+			if (weight == 0.0) {
+				return 0.0;
+			}
+			const double x = p.x, y = p.y, z = p.z;
+			const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return std::max(error, 0.0) / weight;
+		}
+	};
+
+	// vertices that share a position get the same id, they are split by attribute seams (uvs or hard normals)
+	std::vector<uint32_t> get_position_ids(const MeshOptimizer::PositionStream& positions, uint32_t& num_ids) {
+		std::vector<uint32_t> order(positions.num_vertices);
+		std::iota(order.begin(), order.end(), 0);
+		auto less = [&](uint32_t a, uint32_t b) {
+			const glm::vec3 pa = positions.get(a);
+			const glm::vec3 pb = positions.get(b);
+			return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+		};
+		std::sort(order.begin(), order.end(), less);
+		std::vector<uint32_t> ids(positions.num_vertices);
+		num_ids = 0;
+		for (size_t i = 0; i < order.size(); i++) {
+			if (i > 0 && less(order[i - 1], order[i])) {
+				num_ids++;
+			}
+			ids[order[i]] = num_ids;
+		}
+		num_ids += order.empty() ? 0 : 1;
+		return ids;
+	}
+
+	// positions that must not move: attribute seams and open or non manifold edges
+	std::vector<uint8_t> get_locked_positions(std::span<const unsigned int> indices, std::span<const uint32_t> position_ids, uint32_t num_ids) {
+		std::vector<uint8_t> locked(num_ids);
+		std::vector<uint32_t> vertices_per_id(num_ids);
+		for (uint32_t id : position_ids) {
+			vertices_per_id[id]++;
+		}
+		for (uint32_t id = 0; id < num_ids; id++) {
+			locked[id] = vertices_per_id[id] > 1;
+		}
+		// every manifold interior edge is used by exactly two triangles
+		std::vector<uint64_t> edges{};
+		edges.reserve(indices.size());
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				const uint32_t a = position_ids[indices[i + k]];
+				const uint32_t b = position_ids[indices[i + (k + 1) % 3]];
+				edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();) {
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i]) {
+				j++;
+			}
+			if (j - i != 2) {
+				locked[(uint32_t)(edges[i] >> 32)] = 1;
+				locked[(uint32_t)edges[i]] = 1;
+			}
+			i = j;
+		}
+		return locked;
+	}
+
+	// simplifies until at most target_index_count indices remain or the next collapse would move the surface
+	// further than max_error. result_error receives the largest error of the accepted collapses, in mesh units
+	std::vector<unsigned int> simplify(std::span<const unsigned int> indices, const MeshOptimizer::PositionStream& positions,
+		size_t target_index_count, float max_error, float& result_error) {
+		std::vector<unsigned int> result(indices.begin(), indices.end());
+		result_error = 0.0f;
+		if (result.size() <= target_index_count) {
+			return result;
+		}
+		uint32_t num_ids{};
+		const auto position_ids = get_position_ids(positions, num_ids);
+		const auto locked = get_locked_positions(indices, position_ids, num_ids);
+
+		std::vector<Quadric> quadrics(num_ids);
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			const glm::vec3 p0 = positions.get(indices[i]);
+			const glm::vec3 normal = glm::cross(positions.get(indices[i + 1]) - p0, positions.get(indices[i + 2]) - p0);
+			const float area = glm::length(normal);
+			if (area == 0.0f) {
+				continue;
+			}
+			const glm::vec3 n = normal / area;
+			for (size_t k = 0; k < 3; k++) {
+				quadrics[position_ids[indices[i + k]]].add_plane(n, -glm::dot(n, p0), area);
+			}
+		}
+
+		struct Collapse {
+			uint32_t from{};
+			uint32_t to{};
+			float cost{};
+		};
+		std::vector<Collapse> collapses{};
+		std::vector<uint32_t> triangle_offsets(positions.num_vertices + 1);
+		std::vector<uint32_t> vertex_triangles{};
+		std::vector<uint32_t> collapse_target(positions.num_vertices);
+		std::vector<uint8_t> touched(num_ids);
+		const double max_cost = (double)max_error * max_error;
+		double accepted_cost{};
+
+		while (result.size() > target_index_count) {
+			// candidate collapses along every triangle edge, in both directions
+			collapses.clear();
+			for (size_t i = 0; i + 2 < result.size(); i += 3) {
+				for (size_t k = 0; k < 3; k++) {
+					const uint32_t a = result[i + k];
+					const uint32_t b = result[i + (k + 1) % 3];
+					for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+						if (locked[position_ids[from]] || position_ids[from] == position_ids[to]) {
+							continue;
+						}
+						Quadric q = quadrics[position_ids[from]];
+						q += quadrics[position_ids[to]];
+						collapses.push_back(Collapse{ from, to, (float)q.evaluate(positions.get(to)) });
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			// triangles around every vertex
+			std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+			for (unsigned int index : result) {
+				triangle_offsets[index + 1]++;
+			}
+			std::partial_sum(triangle_offsets.begin(), triangle_offsets.end(), triangle_offsets.begin());
+			vertex_triangles.resize(result.size());
+			std::vector<uint32_t> fill = triangle_offsets;
+			for (size_t i = 0; i < result.size(); i++) {
+				vertex_triangles[fill[result[i]]++] = (uint32_t)(i / 3);
+			}
+
+			// accept the cheapest collapses whose neighbourhoods don't overlap, each one removes about two triangles
+			std::iota(collapse_target.begin(), collapse_target.end(), 0);
+			std::fill(touched.begin(), touched.end(), 0);
+			size_t num_triangles = result.size() / 3;
+			size_t num_accepted{};
+			for (const auto& collapse : collapses) {
+				if (num_triangles * 3 <= target_index_count || collapse.cost > max_cost) {
+					break;
+				}
+				if (touched[position_ids[collapse.from]] || touched[position_ids[collapse.to]]) {
+					continue;
+				}
+				// reject collapses that flip a triangle
+				const glm::vec3 new_position = positions.get(collapse.to);
+				bool flips = false;
+				for (uint32_t t = triangle_offsets[collapse.from]; t < triangle_offsets[collapse.from + 1] && !flips; t++) {
+					const unsigned int* triangle = &result[vertex_triangles[t] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+						continue;
+					}
+					glm::vec3 p[3] = { positions.get(triangle[0]), positions.get(triangle[1]), positions.get(triangle[2]) };
+					const glm::vec3 old_normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+					for (size_t k = 0; k < 3; k++) {
+						p[k] = triangle[k] == collapse.from ? new_position : p[k];
+					}
+					const glm::vec3 new_normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+					flips = glm::dot(old_normal, new_normal) <= 0.25f * glm::length(old_normal) * glm::length(new_normal);
+				}
+				if (flips) {
+					continue;
+				}
+				collapse_target[collapse.from] = collapse.to;
+				quadrics[position_ids[collapse.to]] += quadrics[position_ids[collapse.from]];
+				accepted_cost = std::max(accepted_cost, (double)collapse.cost);
+				for (uint32_t t = triangle_offsets[collapse.from]; t < triangle_offsets[collapse.from + 1]; t++) {
+					const unsigned int* triangle = &result[vertex_triangles[t] * 3];
+					touched[position_ids[triangle[0]]] = 1;
+					touched[position_ids[triangle[1]]] = 1;
+					touched[position_ids[triangle[2]]] = 1;
+					const bool collapses_away = triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to;
+					num_triangles -= collapses_away;
+				}
+				num_accepted++;
+			}
+			if (num_accepted == 0) {
+				break;
+			}
+
+			// apply the collapses and drop the triangles that became degenerate
+			size_t write{};
+			for (size_t i = 0; i + 2 < result.size(); i += 3) {
+				const unsigned int a = collapse_target[result[i]];
+				const unsigned int b = collapse_target[result[i + 1]];
+				const unsigned int c = collapse_target[result[i + 2]];
+				if (a != b && b != c && c != a) {
+					result[write++] = a;
+					result[write++] = b;
+					result[write++] = c;
+				}
+			}
+			result.resize(write);
+		}
+		result_error = (float)std::sqrt(accepted_cost);
+		return result;
+	}
+
+	struct LodLevel {
+		std::vector<unsigned int> indices{};
+		float error{}; // geometric deviation from the full detail mesh, in mesh units
+	};
+	struct LodChain {
+		std::vector<LodLevel> levels{}; // coarser levels only, the full detail index buffer is level 0
+		float radius{}; // half the bounding box diagonal, lod_max_error is relative to it
+	};
+
+	// every level keeps about `reduction` of the triangles of the previous one. levels are simplified from the full
+	// detail mesh so their errors are measured against it. max_error is relative to the mesh radius, the chain ends
+	// early when a level can't get meaningfully smaller within it
+	LodChain build_lod_chain(std::span<const unsigned int> indices, const MeshOptimizer::PositionStream& positions,
+		size_t num_levels, float reduction, float max_error) {
+		LodChain chain{};
+		if (positions.num_vertices == 0) {
+			return chain;
+		}
+		glm::vec3 min_corner = positions.get(0);
+		glm::vec3 max_corner = min_corner;
+		for (size_t i = 1; i < positions.num_vertices; i++) {
+			min_corner = glm::min(min_corner, positions.get(i));
+			max_corner = glm::max(max_corner, positions.get(i));
+		}
+		chain.radius = glm::length(max_corner - min_corner) * 0.5f;
+
+		size_t previous_count = indices.size();
+		for (size_t level = 0; level < num_levels; level++) {
+			const size_t target_count = (size_t)(previous_count / 3 * reduction) * 3;
+			float error{};
+			auto lod_indices = simplify(indices, positions, target_count, max_error * chain.radius, error);
+			if (lod_indices.empty() || lod_indices.size() > previous_count * 9 / 10) {
+				break;
+			}
+			previous_count = lod_indices.size();
+			lod_indices = MeshOptimizer::optimize_vertex_cache(lod_indices, positions.num_vertices);
+			chain.levels.push_back(LodLevel{ std::move(lod_indices), error });
+		}
+		return chain;
+	}
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mesh_optimizer.h"
+#include "bounds.h"
+
+// splits a triangle list into small clusters with culling bounds, so whole clusters can be skipped when they are
+// outside the frustum or facing away from the camera
+namespace Meshlets {
+
+	constexpr size_t max_meshlet_vertices = 64;
+	constexpr size_t max_meshlet_triangles = 124;
+
+	struct Meshlet {
+		// the triangles of a meshlet are a contiguous range of the mesh index buffer
+		uint32_t index_offset{};
+		uint32_t index_count{};
+		// range in MeshletData::vertices and MeshletData::triangles, for consumers that want meshlet local indices
+		uint32_t vertex_offset{};
+		uint32_t vertex_count{};
+		uint32_t triangle_offset{}; // in triangles
+		uint32_t triangle_count{};
+		// bounding sphere, in mesh space
+		glm::vec3 center{};
+		float radius{};
+		// backface cone: every triangle faces away from a camera inside the cone around -axis starting at apex,
+		// i.e. when dot(normalize(apex - camera_position), axis) >= cutoff. a cutoff of 1 or more never culls
+		glm::vec3 cone_apex{};
+		glm::vec3 cone_axis{};
+		float cone_cutoff = 1.0f;
+	};
+
+	struct MeshletData {
+		std::vector<Meshlet> meshlets{};
+		std::vector<uint32_t> vertices{}; // mesh vertex index of every meshlet local vertex
+		std::vector<uint8_t> triangles{}; // 3 meshlet local vertex indices per triangle
+	};
+
+	// ritter's approximate bounding sphere: start from the most distant pair of axis extremes, then grow to fit
+	void compute_bounding_sphere(std::span<const uint32_t> vertices, const MeshOptimizer::PositionStream& positions, glm::vec3& center, float& radius) {
+		std::array<size_t, 3> min_vertex{};
+		std::array<size_t, 3> max_vertex{};
+		for (size_t i = 0; i < vertices.size(); i++) {
+			const glm::vec3 p = positions.get(vertices[i]);
+			for (int axis = 0; axis < 3; axis++) {
+				if (p[axis] < positions.get(vertices[min_vertex[axis]])[axis]) { min_vertex[axis] = i; }
+				if (p[axis] > positions.get(vertices[max_vertex[axis]])[axis]) { max_vertex[axis] = i; }
+			}
+		}
+		int widest_axis{};
+		float widest_distance = -1.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			const float distance = glm::distance(positions.get(vertices[min_vertex[axis]]), positions.get(vertices[max_vertex[axis]]));
+			if (distance > widest_distance) {
+				widest_distance = distance;
+				widest_axis = axis;
+			}
+		}
+		const glm::vec3 p0 = positions.get(vertices[min_vertex[widest_axis]]);
+		const glm::vec3 p1 = positions.get(vertices[max_vertex[widest_axis]]);
+		center = (p0 + p1) * 0.5f;
+		radius = widest_distance * 0.5f;
+		for (uint32_t vertex : vertices) {
+			const glm::vec3 p = positions.get(vertex);
+			const float distance = glm::distance(p, center);
+			if (distance > radius) {
+				const float new_radius = (radius + distance) * 0.5f;
+				center += (p - center) * ((new_radius - radius) / distance);
+				radius = new_radius;
+			}
+		}
+	}
+
+	// the axis is the normalized average of the triangle normals, the cutoff comes from the widest normal around it
+	// and the apex is moved back along the axis until it is behind every triangle plane
+	void compute_normal_cone(const MeshletData& data, const Meshlet& meshlet, const MeshOptimizer::PositionStream& positions, Meshlet& out) {
+		std::array<glm::vec3, max_meshlet_triangles> normals{};
+		std::array<glm::vec3, max_meshlet_triangles> corners{};
+		size_t num_normals{};
+		glm::vec3 normal_sum(0.0f);
+		for (size_t t = 0; t < meshlet.triangle_count; t++) {
+			const uint8_t* local = &data.triangles[(meshlet.triangle_offset + t) * 3];
+			const glm::vec3 p0 = positions.get(data.vertices[meshlet.vertex_offset + local[0]]);
+			const glm::vec3 p1 = positions.get(data.vertices[meshlet.vertex_offset + local[1]]);
+			const glm::vec3 p2 = positions.get(data.vertices[meshlet.vertex_offset + local[2]]);
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+			if (area == 0.0f) {
+				continue; // degenerate triangles are never visible
+			}
+			normals[num_normals] = normal / area;
+			corners[num_normals] = p0;
+			normal_sum += normals[num_normals];
+			num_normals++;
+		}
+		const float axis_length = glm::length(normal_sum);
+		if (num_normals == 0 || axis_length == 0.0f) {
+			return;
+		}
+		const glm::vec3 axis = normal_sum / axis_length;
+		float min_dot = 1.0f;
+		for (size_t i = 0; i < num_normals; i++) {
+			min_dot = std::min(min_dot, glm::dot(normals[i], axis));
+		}
+		if (min_dot <= 0.1f) {
+			return; // the normals span a hemisphere (or close to it), the cone would never cull anything
+		}
+		float max_t{};
+		for (size_t i = 0; i < num_normals; i++) {
+			const float t = glm::dot(out.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+			max_t = std::max(max_t, t);
+		}
+		out.cone_apex = out.center - axis * max_t;
+		out.cone_axis = axis;
+		out.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	}
+
+	// greedily packs triangles in index buffer order, so the meshlets keep the vertex cache order of earlier stages
+	// and the mesh index buffer doesn't need to be rewritten
+	MeshletData build_meshlets(std::span<const unsigned int> indices, const MeshOptimizer::PositionStream& positions) {
+		MeshletData data{};
+		data.meshlets.reserve(indices.size() / 3 / max_meshlet_triangles + 1);
+		data.vertices.reserve(indices.size() / 3);
+		data.triangles.reserve(indices.size());
+
+		constexpr uint8_t no_local_index = 0xFF;
+		std::vector<uint8_t> local_indices(positions.num_vertices, no_local_index);
+		Meshlet meshlet{};
+		auto finish_meshlet = [&]() {
+			if (meshlet.triangle_count == 0) {
+				return;
+			}
+			for (size_t i = 0; i < meshlet.vertex_count; i++) {
+				local_indices[data.vertices[meshlet.vertex_offset + i]] = no_local_index;
+			}
+			const std::span<const uint32_t> meshlet_vertices(&data.vertices[meshlet.vertex_offset], meshlet.vertex_count);
+			compute_bounding_sphere(meshlet_vertices, positions, meshlet.center, meshlet.radius);
+			compute_normal_cone(data, meshlet, positions, meshlet);
+			data.meshlets.push_back(meshlet);
+			meshlet = Meshlet{};
+			meshlet.index_offset = (uint32_t)data.triangles.size();
+			meshlet.vertex_offset = (uint32_t)data.vertices.size();
+			meshlet.triangle_offset = (uint32_t)(data.triangles.size() / 3);
+		};
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			size_t new_vertices{};
+			for (size_t k = 0; k < 3; k++) {
+				const unsigned int index = indices[i + k];
+				// a repeated index inside a degenerate triangle is only new once
+				const bool repeated = (k > 0 && indices[i] == index) || (k > 1 && indices[i + 1] == index);
+				new_vertices += local_indices[index] == no_local_index && !repeated;
+			}
+			if (meshlet.vertex_count + new_vertices > max_meshlet_vertices || meshlet.triangle_count == max_meshlet_triangles) {
+				finish_meshlet();
+			}
+			for (size_t k = 0; k < 3; k++) {
+				const unsigned int index = indices[i + k];
+				if (local_indices[index] == no_local_index) {
+					local_indices[index] = (uint8_t)meshlet.vertex_count++;
+					data.vertices.push_back(index);
+				}
+				data.triangles.push_back(local_indices[index]);
+			}
+			meshlet.triangle_count++;
+			meshlet.index_count += 3;
+		}
+		finish_meshlet();
+		return data;
+	}
+
+	bool is_outside_frustum(const Meshlet& meshlet, const Bounds::Frustum& planes) {
+		return Bounds::is_outside_frustum(meshlet.center, meshlet.radius, planes);
+	}
+
+	// only valid when the model transform has no non uniform scale, which would bend the normal cone
+	bool is_backfacing(const Meshlet& meshlet, const glm::vec3& camera_position) {
+		const glm::vec3 to_apex = meshlet.cone_apex - camera_position;
+		const float distance = glm::length(to_apex);
+		return distance > 0.0f && glm::dot(to_apex, meshlet.cone_axis) >= meshlet.cone_cutoff * distance;
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+namespace GLRenderer {
+
+	// first fit sub-allocator over [0, capacity), in whatever units the caller uses. freed ranges are merged with
+	// their free neighbours, the owner of the memory moves allocations around when compacting
+	class RangeAllocator {
+	private:
+		struct FreeBlock {
+			size_t offset{};
+			size_t size{};
+		};
+		std::vector<FreeBlock> free_blocks{}; // sorted by offset, never adjacent
+		size_t capacity{};
+
+	public:
+		std::optional<size_t> allocate(size_t size, size_t alignment = 1) {
+			for (size_t i = 0; i < free_blocks.size(); i++) {
+				auto& block = free_blocks[i];
+				const size_t offset = (block.offset + alignment - 1) / alignment * alignment;
+				const size_t padding = offset - block.offset;
+				if (block.size < padding + size) {
+					continue;
+				}
+				// the alignment padding stays free in front of the allocation
+				const FreeBlock tail{ offset + size, block.size - padding - size };
+				if (padding > 0) {
+					block.size = padding;
+					if (tail.size > 0) {
+						free_blocks.insert(free_blocks.begin() + i + 1, tail);
+					}
+				}
+				else if (tail.size > 0) {
+					block = tail;
+				}
+				else {
+					free_blocks.erase(free_blocks.begin() + i);
+				}
+				return offset;
+			}
+			return std::nullopt;
+		}
+
+		void free(size_t offset, size_t size) {
+			if (size == 0) {
+				return;
+			}
+			auto next = std::lower_bound(free_blocks.begin(), free_blocks.end(), offset, [](const FreeBlock& block, size_t value) { return block.offset < value; });
+			const bool merges_previous = next != free_blocks.begin() && std::prev(next)->offset + std::prev(next)->size == offset;
+			const bool merges_next = next != free_blocks.end() && offset + size == next->offset;
+			if (merges_previous && merges_next) {
+				std::prev(next)->size += size + next->size;
+				free_blocks.erase(next);
+			}
+			else if (merges_previous) {
+				std::prev(next)->size += size;
+			}
+			else if (merges_next) {
+				next->offset = offset;
+				next->size += size;
+			}
+			else {
+				free_blocks.insert(next, FreeBlock{ offset, size });
+			}
+		}
+
+		// the new space at the end becomes free
+		void grow(size_t new_capacity) {
+			if (new_capacity > capacity) {
+				free(capacity, new_capacity - capacity);
+				capacity = new_capacity;
+			}
+		}
+		// everything below used_size is allocated, the rest of new_capacity is free. used after compacting
+		void reset(size_t used_size, size_t new_capacity) {
+			free_blocks.clear();
+			capacity = new_capacity;
+			if (new_capacity > used_size) {
+				free_blocks.push_back(FreeBlock{ used_size, new_capacity - used_size });
+			}
+		}
+
+		size_t get_capacity() const {
+			return capacity;
+		}
+		size_t get_free_size() const {
+			size_t free_size{};
+			for (const auto& block : free_blocks) {
+				free_size += block.size;
+			}
+			return free_size;
+		}
+		size_t get_largest_free_block() const {
+			size_t largest{};
+			for (const auto& block : free_blocks) {
+				largest = std::max(largest, block.size);
+			}
+			return largest;
+		}
+		size_t get_num_free_blocks() const {
+			return free_blocks.size();
+		}
+	};
+}
@@ -30,10 +30,12 @@ class Renderer : public GLRenderer::RendererBase
 {
 public:
 	Camera cam{};
-	std::vector<MeshBuilder::Scene> scenes{};
+	std::vector<MeshBuilder::SceneInstance> scene_instances{};
 
 private:
 	std::unique_ptr<GL3D::ShaderProgram> pbr_shader{};
+	std::unique_ptr<GL3D::ShaderProgram> pbr_instanced_shader{};
+	std::unique_ptr<GLRenderer::InstanceBuffer> instance_buffer{};
 
 	std::unique_ptr<GL3D::Mesh> screen_quad_mesh{};
 	std::unique_ptr<GL3D::ShaderProgram> screen_shader{};
@@ -70,6 +72,14 @@ public:
 		}
 		pbr_shader = std::move(pbr_shader_res.value());
 
+		auto pbr_instanced_shader_res = GLRenderer::ShaderBuilder::build(asset_dir + "shaders/pbr_frag.glsl", asset_dir + "shaders/pbr_vertex_instanced.glsl");
+		if (!pbr_instanced_shader_res.has_value()) {
+			std::cout << pbr_instanced_shader_res.error().err_msg << "\n";
+			assert(false);
+		}
+		pbr_instanced_shader = std::move(pbr_instanced_shader_res.value());
+		instance_buffer = std::make_unique<GLRenderer::InstanceBuffer>();
+
 		auto screen_shader_res = GLRenderer::ShaderBuilder::build(asset_dir + "shaders/screen_frag.glsl", asset_dir + "shaders/screen_vertex.glsl");
 		if (!screen_shader_res.has_value()) {
 			std::cout << screen_shader_res.error().err_msg << "\n";
@@ -94,9 +104,7 @@ public:
 		glEnable(GL_BLEND); // enable blending function
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-		for (const auto& scene : scenes) {
-			draw_scene(cam, scene, *pbr_shader);
-		}
+		draw_scene_instances(cam, scene_instances, *pbr_shader, *pbr_instanced_shader, *instance_buffer);
 		
 		framebuffer->unbind();
 
@@ -1,35 +1,172 @@
 #pragma once
 
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <tuple>
+#include <span>
+
 #include <GLExternalRAII/glfw_window_raii.h>
 #include <GL3D/shader.h>
 
 #include "mesh_builder.h"
 #include "camera.h"
+#include "simd_kernels.h"
 
-void draw_mesh(const Camera& cam, const MeshBuilder::Node& node, const MeshBuilder::Mesh& mesh, const GL3D::ShaderProgram& shader) {
-	const glm::mat4 global_transform = node.get_global_transform();;
-	glm::mat4 view = cam.get_view_matrix();
-	glm::mat4 projection = cam.get_projection_matrix();
-	glm::mat4 transform_matrix = projection * view * global_transform;
-	shader.set_uniform("uMat", transform_matrix);
-	auto& material = mesh.material;
+// visible index ranges of a mesh split into meshlets, neighbouring visible meshlets are merged into one range.
+// culling happens in mesh space, the meshlet bounds are computed on the unquantized positions
+std::vector<GLRenderer::IndexRange> get_visible_meshlet_ranges(const Meshlets::MeshletData& meshlets, const glm::mat4& view, const glm::mat4& projection, const glm::mat4& global_transform) {
+	const auto planes = Bounds::get_frustum_planes(projection * view * global_transform);
+	const glm::vec3 camera_position = glm::vec3(glm::inverse(view * global_transform) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	// the sphere tests in one batch, every meshlet's center is followed by its radius
+	static_assert(offsetof(Meshlets::Meshlet, radius) == offsetof(Meshlets::Meshlet, center) + sizeof(glm::vec3));
+	std::vector<uint8_t> outside(meshlets.meshlets.size());
+	if (!outside.empty()) {
+		SimdKernels::cull_spheres(planes, &meshlets.meshlets[0].center.x, outside.size(), sizeof(Meshlets::Meshlet) / sizeof(float), outside.data());
+	}
+	std::vector<GLRenderer::IndexRange> ranges{};
+	for (size_t i = 0; i < meshlets.meshlets.size(); i++) {
+		const auto& meshlet = meshlets.meshlets[i];
+		if (outside[i] || Meshlets::is_backfacing(meshlet, camera_position)) {
+			continue;
+		}
+		if (!ranges.empty() && ranges.back().offset + ranges.back().count == meshlet.index_offset) {
+			ranges.back().count += meshlet.index_count;
+		}
+		else {
+			ranges.push_back(GLRenderer::IndexRange{ meshlet.index_offset, meshlet.index_count });
+		}
+	}
+	return ranges;
+}
+void set_material(const MeshBuilder::Material& material, const GL3D::ShaderProgram& shader) {
 	if (material.diffuse_texture) { shader.set_texture("uDiffuse", *material.diffuse_texture, 0); }
 	if (material.normal_texture) { shader.set_texture("uNormal", *material.normal_texture, 1); }
 	if (material.roughness_texture) { shader.set_texture("uRoughness", *material.roughness_texture, 2); }
 	if (material.metallic_texture) { shader.set_texture("uMetallic", *material.metallic_texture, 3); }
-	mesh.mesh->draw(shader);
 }
-void draw_single_node(const Camera& cam, const MeshBuilder::Node& node, const GL3D::ShaderProgram& shader) {
-	for (size_t i = 0; i < node.meshes.size(); i++) {
-		draw_mesh(cam, node, node.meshes[i], shader);
+// screen space error a mesh lod may have, as a fraction of the screen height. about 2 pixels at 1080p
+constexpr float max_lod_screen_error = 0.002f;
+
+// the coarsest level whose geometric error projects below max_lod_screen_error, 0 for meshes without lods
+size_t select_lod(const MeshBuilder::Mesh& mesh, const Camera& cam, const glm::mat4& projection, const glm::mat4& global_transform) {
+	const auto& lods = mesh.lods;
+	if (lods.levels.size() < 2) {
+		return 0;
 	}
+	const float scale = std::max({ glm::length(glm::vec3(global_transform[0])), glm::length(glm::vec3(global_transform[1])), glm::length(glm::vec3(global_transform[2])) });
+	const glm::vec3 center = glm::vec3(global_transform * glm::vec4(mesh.bounding_sphere.center, 1.0f));
+	const float distance = std::max(glm::distance(center, cam.position) - mesh.bounding_sphere.radius * scale, (float)cam.near_plane_dist);
+	// projection[1][1] is 1 / tan(fov / 2), the screen height spans 2 / projection[1][1] at distance 1
+	const float error_to_screen = scale * projection[1][1] * 0.5f / distance;
+	size_t lod = 0;
+	while (lod + 1 < lods.levels.size() && lods.levels[lod + 1].error * error_to_screen <= max_lod_screen_error) {
+		lod++;
+	}
+	return lod;
 }
-void draw_node(const Camera& cam, const MeshBuilder::Node& node, const GL3D::ShaderProgram& shader) {
-	draw_single_node(cam, node, shader);
-	for (size_t i = 0; i < node.child_nodes.size(); i++) {
-		draw_node(cam, *node.child_nodes[i], shader);
+void draw_mesh(const Camera& cam, const glm::mat4& global_transform, const MeshBuilder::Mesh& mesh, const MeshBuilder::Material& material, const GL3D::ShaderProgram& shader) {
+	glm::mat4 view = cam.get_view_matrix();
+	glm::mat4 projection = cam.get_projection_matrix();
+	// the meshlets only cover the full detail level, coarser levels are drawn whole
+	std::vector<GLRenderer::IndexRange> visible_ranges{};
+	const size_t lod = select_lod(mesh, cam, projection, global_transform);
+	if (lod > 0) {
+		visible_ranges.push_back(mesh.lods.levels[lod].range);
+	}
+	else if (!mesh.meshlets.meshlets.empty()) {
+		visible_ranges = get_visible_meshlet_ranges(mesh.meshlets, view, projection, global_transform);
+		if (visible_ranges.empty()) {
+			return;
+		}
+	}
+	else if (!mesh.lods.levels.empty()) {
+		visible_ranges.push_back(mesh.lods.levels[0].range);
+	}
+	glm::mat4 transform_matrix = projection * view * global_transform * mesh.dequantization;
+	shader.set_uniform("uMat", transform_matrix);
+	set_material(material, shader);
+	if (visible_ranges.empty()) {
+		mesh.mesh->draw(shader);
+	}
+	else {
+		mesh.mesh->draw_ranges(shader, visible_ranges);
+	}
+}
+
+// instancing: every frame the visible nodes of all scene instances are grouped by mesh, material and lod. groups
+// with at least min_instances nodes are drawn with one instanced call, the rest go through draw_mesh. instances of
+// the same asset share their groups, so placing a scene again only adds transforms
+constexpr size_t min_instances = 2;
+
+struct InstanceGroup {
+	const MeshBuilder::Mesh* mesh{};
+	const MeshBuilder::Material* material{};
+	size_t lod{};
+	std::vector<glm::mat4> global_transforms{};
+};
+using InstanceGroupIndex = std::map<std::tuple<const MeshBuilder::Mesh*, const MeshBuilder::Material*, size_t>, size_t>;
+
+// the planes are in the asset's space, so the node bounds are tested without transforming them
+void collect_instances(const Camera& cam, const MeshBuilder::SceneInstance& instance, const MeshBuilder::Node& node, const Bounds::Frustum& planes, const glm::mat4& projection, InstanceGroupIndex& group_index, std::vector<InstanceGroup>& groups) {
+	if (Bounds::is_outside_frustum(node.get_bounds(), planes)) {
+		return;
+	}
+	const glm::mat4 global_transform = instance.get_global_transform(node);
+	for (const auto& mesh : node.get_meshes()) {
+		const MeshBuilder::Material* material = &instance.get_material(*mesh);
+		const size_t lod = select_lod(*mesh, cam, projection, global_transform);
+		auto [it, inserted] = group_index.try_emplace({ mesh.get(), material, lod }, groups.size());
+		if (inserted) {
+			groups.push_back(InstanceGroup{ mesh.get(), material, lod });
+		}
+		groups[it->second].global_transforms.push_back(global_transform);
+	}
+	for (const auto child : node.get_children()) {
+		collect_instances(cam, instance, child, planes, projection, group_index, groups);
 	}
 }
-void draw_scene(const Camera& cam, const MeshBuilder::Scene& scene, const GL3D::ShaderProgram& shader) {
-	draw_node(cam, *scene.root_node, shader);
+void draw_scene_instances(const Camera& cam, std::span<const MeshBuilder::SceneInstance> instances, const GL3D::ShaderProgram& shader, const GL3D::ShaderProgram& instanced_shader, GLRenderer::InstanceBuffer& instance_buffer) {
+	const glm::mat4 view = cam.get_view_matrix();
+	const glm::mat4 projection = cam.get_projection_matrix();
+	InstanceGroupIndex group_index{};
+	std::vector<InstanceGroup> groups{};
+	for (const auto& instance : instances) {
+		if (instance.is_visible) {
+			const auto planes = Bounds::get_frustum_planes(projection * view * instance.root_transform);
+			collect_instances(cam, instance, instance.asset->get_root_node(), planes, projection, group_index, groups);
+		}
+	}
+
+	// one upload for the whole frame, every group reads its own part of the buffer
+	std::vector<glm::mat4> instance_transforms{};
+	std::vector<size_t> first_instances(groups.size());
+	for (size_t i = 0; i < groups.size(); i++) {
+		const auto& group = groups[i];
+		if (group.global_transforms.size() < min_instances) {
+			draw_mesh(cam, group.global_transforms[0], *group.mesh, *group.material, shader);
+			continue;
+		}
+		first_instances[i] = instance_transforms.size();
+		for (const auto& global_transform : group.global_transforms) {
+			instance_transforms.push_back(global_transform * group.mesh->dequantization);
+		}
+	}
+	if (instance_transforms.empty()) {
+		return;
+	}
+	instance_buffer.upload(instance_transforms);
+	instanced_shader.set_uniform("uViewProjection", projection * view);
+
+	// the meshlets only help a single transform, instanced groups draw their whole lod
+	for (size_t i = 0; i < groups.size(); i++) {
+		const auto& group = groups[i];
+		if (group.global_transforms.size() < min_instances) {
+			continue;
+		}
+		const auto& mesh = *group.mesh;
+		const GLRenderer::IndexRange range = mesh.lods.levels.empty() ? GLRenderer::IndexRange{ 0, mesh.mesh->get_index_count() } : mesh.lods.levels[group.lod].range;
+		set_material(*group.material, instanced_shader);
+		mesh.mesh->draw_instanced(instanced_shader, range, instance_buffer, first_instances[i], group.global_transforms.size());
+	}
 }
\ No newline at end of file
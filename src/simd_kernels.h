@@ -0,0 +1,564 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <assimp/matrix4x4.h>
+
+#include "bounds.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define SIMD_KERNELS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SIMD_KERNELS_TARGET_SSE41
+#define SIMD_KERNELS_TARGET_AVX2
+#else
+#define SIMD_KERNELS_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SIMD_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_KERNELS_NEON
+#endif
+
+// batch math over contiguous arrays. every kernel has a scalar reference and sse4.1, avx2 and neon versions, the best
+// one the cpu supports is picked once at runtime. the vector versions do the same multiplies and adds in the same
+// order as the scalar ones and never fuse them, so they return the same results bit for bit as long as the compiler
+// doesn't contract the scalar code
+namespace SimdKernels {
+
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float));
+	static_assert(sizeof(aiMatrix4x4) == 16 * sizeof(float), "assimp has to be built with single precision");
+	static_assert(sizeof(Bounds::AABB) == 6 * sizeof(float));
+
+	enum class Level {
+		scalar,
+		sse41,
+		avx2,
+		neon,
+	};
+
+	struct Kernels {
+		Level level{};
+		// out[i] = a[i] * b
+		void (*multiply)(const glm::mat4* a, const glm::mat4& b, glm::mat4* out, size_t count){};
+		// in place, the point i is the first three floats at points + i * stride. w is taken as 1 and not divided by
+		void (*transform_points)(const glm::mat4& transform, float* points, size_t count, size_t stride){};
+		// Bounds::transform_aabb on every box, out may be in
+		void (*transform_aabbs)(const glm::mat4& transform, const Bounds::AABB* aabbs, Bounds::AABB* out, size_t count){};
+		// the sphere i is center and radius at spheres + i * stride, outside[i] is 1 where Bounds::is_outside_frustum
+		void (*cull_spheres)(const Bounds::Frustum& planes, const float* spheres, size_t count, size_t stride, uint8_t* outside){};
+		// assimp matrices are row major, glm ones column major
+		void (*convert_ai_matrices)(const aiMatrix4x4* matrices, glm::mat4* out, size_t count){};
+	};
+
+	namespace Scalar {
+		void multiply(const glm::mat4* a, const glm::mat4& b, glm::mat4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = a[i] * b;
+			}
+		}
+		void transform_points(const glm::mat4& transform, float* points, size_t count, size_t stride) {
+			for (size_t i = 0; i < count; i++) {
+				float* p = points + i * stride;
+				const glm::vec4 result = transform * glm::vec4(p[0], p[1], p[2], 1.0f);
+				p[0] = result.x;
+				p[1] = result.y;
+				p[2] = result.z;
+			}
+		}
+		void transform_aabbs(const glm::mat4& transform, const Bounds::AABB* aabbs, Bounds::AABB* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = Bounds::transform_aabb(aabbs[i], transform);
+			}
+		}
+		void cull_spheres(const Bounds::Frustum& planes, const float* spheres, size_t count, size_t stride, uint8_t* outside) {
+			for (size_t i = 0; i < count; i++) {
+				const float* sphere = spheres + i * stride;
+				outside[i] = Bounds::is_outside_frustum(glm::vec3(sphere[0], sphere[1], sphere[2]), sphere[3], planes);
+			}
+		}
+		void convert_ai_matrices(const aiMatrix4x4* matrices, glm::mat4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const aiMatrix4x4& from = matrices[i];
+				glm::mat4& to = out[i];
+				//the a,b,c,d in assimp is the row ; the 1,2,3,4 is the column
+				to[0][0] = from.a1; to[1][0] = from.a2; to[2][0] = from.a3; to[3][0] = from.a4;
+				to[0][1] = from.b1; to[1][1] = from.b2; to[2][1] = from.b3; to[3][1] = from.b4;
+				to[0][2] = from.c1; to[1][2] = from.c2; to[2][2] = from.c3; to[3][2] = from.c4;
+				to[0][3] = from.d1; to[1][3] = from.d2; to[2][3] = from.d3; to[3][3] = from.d4;
+			}
+		}
+	}
+
+#if defined(SIMD_KERNELS_X86)
+	namespace Sse41 {
+		// exactly three floats, the vector loads could read past the end of the array
+		SIMD_KERNELS_TARGET_SSE41 __m128 load_vec3(const float* p) {
+			const __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p));
+			return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+		}
+		SIMD_KERNELS_TARGET_SSE41 void store_vec3(float* p, __m128 v) {
+			_mm_storel_pi(reinterpret_cast<__m64*>(p), v);
+			_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+		}
+		// (columns[0] * v.x + columns[1] * v.y) + (columns[2] * v.z + columns[3]), glm's mat4 * vec4 with w = 1
+		SIMD_KERNELS_TARGET_SSE41 __m128 transform_point(const __m128* columns, __m128 v) {
+			const __m128 xy = _mm_add_ps(_mm_mul_ps(columns[0], _mm_shuffle_ps(v, v, 0x00)), _mm_mul_ps(columns[1], _mm_shuffle_ps(v, v, 0x55)));
+			const __m128 zw = _mm_add_ps(_mm_mul_ps(columns[2], _mm_shuffle_ps(v, v, 0xaa)), columns[3]);
+			return _mm_add_ps(xy, zw);
+		}
+
+		SIMD_KERNELS_TARGET_SSE41 void multiply(const glm::mat4* a, const glm::mat4& b, glm::mat4* out, size_t count) {
+			// column j of the product is the sum over k of column k of a times b[j][k]
+			const float* b_elements = reinterpret_cast<const float*>(&b);
+			__m128 b_broadcasts[16];
+			for (int e = 0; e < 16; e++) {
+				b_broadcasts[e] = _mm_set1_ps(b_elements[e]);
+			}
+			for (size_t i = 0; i < count; i++) {
+				const float* a_elements = reinterpret_cast<const float*>(a + i);
+				const __m128 a_0 = _mm_loadu_ps(a_elements);
+				const __m128 a_1 = _mm_loadu_ps(a_elements + 4);
+				const __m128 a_2 = _mm_loadu_ps(a_elements + 8);
+				const __m128 a_3 = _mm_loadu_ps(a_elements + 12);
+				float* result = reinterpret_cast<float*>(out + i);
+				for (int j = 0; j < 4; j++) {
+					__m128 column = _mm_mul_ps(a_0, b_broadcasts[j * 4]);
+					column = _mm_add_ps(column, _mm_mul_ps(a_1, b_broadcasts[j * 4 + 1]));
+					column = _mm_add_ps(column, _mm_mul_ps(a_2, b_broadcasts[j * 4 + 2]));
+					column = _mm_add_ps(column, _mm_mul_ps(a_3, b_broadcasts[j * 4 + 3]));
+					_mm_storeu_ps(result + j * 4, column);
+				}
+			}
+		}
+		SIMD_KERNELS_TARGET_SSE41 void transform_points(const glm::mat4& transform, float* points, size_t count, size_t stride) {
+			const float* elements = reinterpret_cast<const float*>(&transform);
+			const __m128 columns[4] = { _mm_loadu_ps(elements), _mm_loadu_ps(elements + 4), _mm_loadu_ps(elements + 8), _mm_loadu_ps(elements + 12) };
+			for (size_t i = 0; i < count; i++) {
+				float* p = points + i * stride;
+				store_vec3(p, transform_point(columns, load_vec3(p)));
+			}
+		}
+		SIMD_KERNELS_TARGET_SSE41 void transform_aabbs(const glm::mat4& transform, const Bounds::AABB* aabbs, Bounds::AABB* out, size_t count) {
+			const float* elements = reinterpret_cast<const float*>(&transform);
+			const __m128 columns[4] = { _mm_loadu_ps(elements), _mm_loadu_ps(elements + 4), _mm_loadu_ps(elements + 8), _mm_loadu_ps(elements + 12) };
+			const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+			const __m128 abs_0 = _mm_and_ps(columns[0], abs_mask);
+			const __m128 abs_1 = _mm_and_ps(columns[1], abs_mask);
+			const __m128 abs_2 = _mm_and_ps(columns[2], abs_mask);
+			const __m128 half = _mm_set1_ps(0.5f);
+			for (size_t i = 0; i < count; i++) {
+				const float* box = reinterpret_cast<const float*>(aabbs + i);
+				const __m128 min = load_vec3(box);
+				const __m128 max = load_vec3(box + 3);
+				const __m128 center = transform_point(columns, _mm_mul_ps(_mm_add_ps(min, max), half));
+				const __m128 extent = _mm_mul_ps(_mm_sub_ps(max, min), half);
+				__m128 new_extent = _mm_mul_ps(abs_0, _mm_shuffle_ps(extent, extent, 0x00));
+				new_extent = _mm_add_ps(new_extent, _mm_mul_ps(abs_1, _mm_shuffle_ps(extent, extent, 0x55)));
+				new_extent = _mm_add_ps(new_extent, _mm_mul_ps(abs_2, _mm_shuffle_ps(extent, extent, 0xaa)));
+				// empty boxes are passed through
+				__m128 is_empty = _mm_cmpgt_ps(min, max);
+				is_empty = _mm_shuffle_ps(is_empty, is_empty, 0x00);
+				float* result = reinterpret_cast<float*>(out + i);
+				store_vec3(result, _mm_blendv_ps(_mm_sub_ps(center, new_extent), min, is_empty));
+				store_vec3(result + 3, _mm_blendv_ps(_mm_add_ps(center, new_extent), max, is_empty));
+			}
+		}
+		SIMD_KERNELS_TARGET_SSE41 void cull_spheres(const Bounds::Frustum& planes, const float* spheres, size_t count, size_t stride, uint8_t* outside) {
+			__m128 plane_broadcasts[6][4];
+			for (size_t p = 0; p < planes.size(); p++) {
+				for (int k = 0; k < 4; k++) {
+					plane_broadcasts[p][k] = _mm_set1_ps(planes[p][k]);
+				}
+			}
+			const __m128 sign_mask = _mm_set1_ps(-0.0f);
+			size_t i = 0;
+			// four spheres at a time, transposed so every lane holds one sphere
+			for (; i + 4 <= count; i += 4) {
+				__m128 x = _mm_loadu_ps(spheres + i * stride);
+				__m128 y = _mm_loadu_ps(spheres + (i + 1) * stride);
+				__m128 z = _mm_loadu_ps(spheres + (i + 2) * stride);
+				__m128 radius = _mm_loadu_ps(spheres + (i + 3) * stride);
+				_MM_TRANSPOSE4_PS(x, y, z, radius);
+				const __m128 negative_radius = _mm_xor_ps(radius, sign_mask);
+				__m128 is_outside = _mm_setzero_ps();
+				for (const auto& plane : plane_broadcasts) {
+					__m128 distance = _mm_mul_ps(plane[0], x);
+					distance = _mm_add_ps(distance, _mm_mul_ps(plane[1], y));
+					distance = _mm_add_ps(distance, _mm_mul_ps(plane[2], z));
+					distance = _mm_add_ps(distance, plane[3]);
+					is_outside = _mm_or_ps(is_outside, _mm_cmplt_ps(distance, negative_radius));
+				}
+				const int mask = _mm_movemask_ps(is_outside);
+				for (int k = 0; k < 4; k++) {
+					outside[i + k] = (mask >> k) & 1;
+				}
+			}
+			Scalar::cull_spheres(planes, spheres + i * stride, count - i, stride, outside + i);
+		}
+		SIMD_KERNELS_TARGET_SSE41 void convert_ai_matrices(const aiMatrix4x4* matrices, glm::mat4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const float* rows = reinterpret_cast<const float*>(matrices + i);
+				__m128 row_0 = _mm_loadu_ps(rows);
+				__m128 row_1 = _mm_loadu_ps(rows + 4);
+				__m128 row_2 = _mm_loadu_ps(rows + 8);
+				__m128 row_3 = _mm_loadu_ps(rows + 12);
+				_MM_TRANSPOSE4_PS(row_0, row_1, row_2, row_3);
+				float* columns = reinterpret_cast<float*>(out + i);
+				_mm_storeu_ps(columns, row_0);
+				_mm_storeu_ps(columns + 4, row_1);
+				_mm_storeu_ps(columns + 8, row_2);
+				_mm_storeu_ps(columns + 12, row_3);
+			}
+		}
+	}
+
+	// two items per register, one in each 128 bit lane. the in-lane shuffles work like the sse ones, leftovers go
+	// through the sse4.1 kernels
+	namespace Avx2 {
+		SIMD_KERNELS_TARGET_AVX2 __m256 combine(__m128 low, __m128 high) {
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+		}
+		SIMD_KERNELS_TARGET_AVX2 __m256 transform_point(const __m256* columns, __m256 v) {
+			const __m256 xy = _mm256_add_ps(_mm256_mul_ps(columns[0], _mm256_permute_ps(v, 0x00)), _mm256_mul_ps(columns[1], _mm256_permute_ps(v, 0x55)));
+			const __m256 zw = _mm256_add_ps(_mm256_mul_ps(columns[2], _mm256_permute_ps(v, 0xaa)), columns[3]);
+			return _mm256_add_ps(xy, zw);
+		}
+		// 4x4 transpose inside both lanes
+		SIMD_KERNELS_TARGET_AVX2 void transpose(__m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+			const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+			const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+			const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+			const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+			r0 = _mm256_shuffle_ps(t0, t2, 0x44);
+			r1 = _mm256_shuffle_ps(t0, t2, 0xee);
+			r2 = _mm256_shuffle_ps(t1, t3, 0x44);
+			r3 = _mm256_shuffle_ps(t1, t3, 0xee);
+		}
+
+		SIMD_KERNELS_TARGET_AVX2 void multiply(const glm::mat4* a, const glm::mat4& b, glm::mat4* out, size_t count) {
+			// columns 0 and 1 of the product in one register, 2 and 3 in the other. a's columns are duplicated into both
+			// lanes and b's elements broadcast inside each lane
+			const float* b_elements = reinterpret_cast<const float*>(&b);
+			const __m256 b_01 = _mm256_loadu_ps(b_elements);
+			const __m256 b_23 = _mm256_loadu_ps(b_elements + 8);
+			const __m256 b_01_broadcasts[4] = { _mm256_permute_ps(b_01, 0x00), _mm256_permute_ps(b_01, 0x55), _mm256_permute_ps(b_01, 0xaa), _mm256_permute_ps(b_01, 0xff) };
+			const __m256 b_23_broadcasts[4] = { _mm256_permute_ps(b_23, 0x00), _mm256_permute_ps(b_23, 0x55), _mm256_permute_ps(b_23, 0xaa), _mm256_permute_ps(b_23, 0xff) };
+			for (size_t i = 0; i < count; i++) {
+				const float* a_elements = reinterpret_cast<const float*>(a + i);
+				__m256 a_columns[4];
+				for (int k = 0; k < 4; k++) {
+					a_columns[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a_elements + k * 4));
+				}
+				__m256 columns_01 = _mm256_mul_ps(a_columns[0], b_01_broadcasts[0]);
+				__m256 columns_23 = _mm256_mul_ps(a_columns[0], b_23_broadcasts[0]);
+				for (int k = 1; k < 4; k++) {
+					columns_01 = _mm256_add_ps(columns_01, _mm256_mul_ps(a_columns[k], b_01_broadcasts[k]));
+					columns_23 = _mm256_add_ps(columns_23, _mm256_mul_ps(a_columns[k], b_23_broadcasts[k]));
+				}
+				float* result = reinterpret_cast<float*>(out + i);
+				_mm256_storeu_ps(result, columns_01);
+				_mm256_storeu_ps(result + 8, columns_23);
+			}
+		}
+		SIMD_KERNELS_TARGET_AVX2 void transform_points(const glm::mat4& transform, float* points, size_t count, size_t stride) {
+			const float* elements = reinterpret_cast<const float*>(&transform);
+			__m256 columns[4];
+			for (int k = 0; k < 4; k++) {
+				columns[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(elements + k * 4));
+			}
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2) {
+				float* p_0 = points + i * stride;
+				float* p_1 = p_0 + stride;
+				const __m256 result = transform_point(columns, combine(Sse41::load_vec3(p_0), Sse41::load_vec3(p_1)));
+				Sse41::store_vec3(p_0, _mm256_castps256_ps128(result));
+				Sse41::store_vec3(p_1, _mm256_extractf128_ps(result, 1));
+			}
+			Sse41::transform_points(transform, points + i * stride, count - i, stride);
+		}
+		SIMD_KERNELS_TARGET_AVX2 void transform_aabbs(const glm::mat4& transform, const Bounds::AABB* aabbs, Bounds::AABB* out, size_t count) {
+			const float* elements = reinterpret_cast<const float*>(&transform);
+			__m256 columns[4];
+			for (int k = 0; k < 4; k++) {
+				columns[k] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(elements + k * 4));
+			}
+			const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+			const __m256 abs_columns[3] = { _mm256_and_ps(columns[0], abs_mask), _mm256_and_ps(columns[1], abs_mask), _mm256_and_ps(columns[2], abs_mask) };
+			const __m256 half = _mm256_set1_ps(0.5f);
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2) {
+				const float* box_0 = reinterpret_cast<const float*>(aabbs + i);
+				const float* box_1 = reinterpret_cast<const float*>(aabbs + i + 1);
+				const __m256 min = combine(Sse41::load_vec3(box_0), Sse41::load_vec3(box_1));
+				const __m256 max = combine(Sse41::load_vec3(box_0 + 3), Sse41::load_vec3(box_1 + 3));
+				const __m256 center = transform_point(columns, _mm256_mul_ps(_mm256_add_ps(min, max), half));
+				const __m256 extent = _mm256_mul_ps(_mm256_sub_ps(max, min), half);
+				__m256 new_extent = _mm256_mul_ps(abs_columns[0], _mm256_permute_ps(extent, 0x00));
+				new_extent = _mm256_add_ps(new_extent, _mm256_mul_ps(abs_columns[1], _mm256_permute_ps(extent, 0x55)));
+				new_extent = _mm256_add_ps(new_extent, _mm256_mul_ps(abs_columns[2], _mm256_permute_ps(extent, 0xaa)));
+				const __m256 is_empty = _mm256_permute_ps(_mm256_cmp_ps(min, max, _CMP_GT_OQ), 0x00);
+				const __m256 new_min = _mm256_blendv_ps(_mm256_sub_ps(center, new_extent), min, is_empty);
+				const __m256 new_max = _mm256_blendv_ps(_mm256_add_ps(center, new_extent), max, is_empty);
+				float* result_0 = reinterpret_cast<float*>(out + i);
+				float* result_1 = reinterpret_cast<float*>(out + i + 1);
+				Sse41::store_vec3(result_0, _mm256_castps256_ps128(new_min));
+				Sse41::store_vec3(result_0 + 3, _mm256_castps256_ps128(new_max));
+				Sse41::store_vec3(result_1, _mm256_extractf128_ps(new_min, 1));
+				Sse41::store_vec3(result_1 + 3, _mm256_extractf128_ps(new_max, 1));
+			}
+			Sse41::transform_aabbs(transform, aabbs + i, out + i, count - i);
+		}
+		SIMD_KERNELS_TARGET_AVX2 void cull_spheres(const Bounds::Frustum& planes, const float* spheres, size_t count, size_t stride, uint8_t* outside) {
+			__m256 plane_broadcasts[6][4];
+			for (size_t p = 0; p < planes.size(); p++) {
+				for (int k = 0; k < 4; k++) {
+					plane_broadcasts[p][k] = _mm256_set1_ps(planes[p][k]);
+				}
+			}
+			const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+			size_t i = 0;
+			// eight spheres at a time, 0 to 3 in the low lane and 4 to 7 in the high one
+			for (; i + 8 <= count; i += 8) {
+				__m256 r[4];
+				for (size_t k = 0; k < 4; k++) {
+					r[k] = combine(_mm_loadu_ps(spheres + (i + k) * stride), _mm_loadu_ps(spheres + (i + k + 4) * stride));
+				}
+				transpose(r[0], r[1], r[2], r[3]);
+				const __m256 x = r[0];
+				const __m256 y = r[1];
+				const __m256 z = r[2];
+				const __m256 negative_radius = _mm256_xor_ps(r[3], sign_mask);
+				__m256 is_outside = _mm256_setzero_ps();
+				for (const auto& plane : plane_broadcasts) {
+					__m256 distance = _mm256_mul_ps(plane[0], x);
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(plane[1], y));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(plane[2], z));
+					distance = _mm256_add_ps(distance, plane[3]);
+					is_outside = _mm256_or_ps(is_outside, _mm256_cmp_ps(distance, negative_radius, _CMP_LT_OQ));
+				}
+				const int mask = _mm256_movemask_ps(is_outside);
+				for (int k = 0; k < 8; k++) {
+					outside[i + k] = (mask >> k) & 1;
+				}
+			}
+			Sse41::cull_spheres(planes, spheres + i * stride, count - i, stride, outside + i);
+		}
+		SIMD_KERNELS_TARGET_AVX2 void convert_ai_matrices(const aiMatrix4x4* matrices, glm::mat4* out, size_t count) {
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2) {
+				const float* rows_0 = reinterpret_cast<const float*>(matrices + i);
+				const float* rows_1 = reinterpret_cast<const float*>(matrices + i + 1);
+				__m256 r[4];
+				for (int k = 0; k < 4; k++) {
+					r[k] = combine(_mm_loadu_ps(rows_0 + k * 4), _mm_loadu_ps(rows_1 + k * 4));
+				}
+				transpose(r[0], r[1], r[2], r[3]);
+				float* columns_0 = reinterpret_cast<float*>(out + i);
+				float* columns_1 = reinterpret_cast<float*>(out + i + 1);
+				for (int k = 0; k < 4; k++) {
+					_mm_storeu_ps(columns_0 + k * 4, _mm256_castps256_ps128(r[k]));
+					_mm_storeu_ps(columns_1 + k * 4, _mm256_extractf128_ps(r[k], 1));
+				}
+			}
+			Sse41::convert_ai_matrices(matrices + i, out + i, count - i);
+		}
+	}
+#endif
+
+#if defined(SIMD_KERNELS_NEON)
+	namespace Neon {
+		float32x4_t load_vec3(const float* p) {
+			return vcombine_f32(vld1_f32(p), vset_lane_f32(p[2], vdup_n_f32(0.0f), 0));
+		}
+		void store_vec3(float* p, float32x4_t v) {
+			vst1_f32(p, vget_low_f32(v));
+			vst1q_lane_f32(p + 2, v, 2);
+		}
+		float32x4_t transform_point(const float32x4_t* columns, float32x4_t v) {
+			const float32x4_t xy = vaddq_f32(vmulq_laneq_f32(columns[0], v, 0), vmulq_laneq_f32(columns[1], v, 1));
+			const float32x4_t zw = vaddq_f32(vmulq_laneq_f32(columns[2], v, 2), columns[3]);
+			return vaddq_f32(xy, zw);
+		}
+		void load_columns(const glm::mat4& transform, float32x4_t* columns) {
+			const float* elements = reinterpret_cast<const float*>(&transform);
+			for (int k = 0; k < 4; k++) {
+				columns[k] = vld1q_f32(elements + k * 4);
+			}
+		}
+
+		void multiply(const glm::mat4* a, const glm::mat4& b, glm::mat4* out, size_t count) {
+			float32x4_t b_columns[4];
+			load_columns(b, b_columns);
+			for (size_t i = 0; i < count; i++) {
+				float32x4_t a_columns[4];
+				load_columns(a[i], a_columns);
+				float* result = reinterpret_cast<float*>(out + i);
+				for (int j = 0; j < 4; j++) {
+					float32x4_t column = vmulq_laneq_f32(a_columns[0], b_columns[j], 0);
+					column = vaddq_f32(column, vmulq_laneq_f32(a_columns[1], b_columns[j], 1));
+					column = vaddq_f32(column, vmulq_laneq_f32(a_columns[2], b_columns[j], 2));
+					column = vaddq_f32(column, vmulq_laneq_f32(a_columns[3], b_columns[j], 3));
+					vst1q_f32(result + j * 4, column);
+				}
+			}
+		}
+		void transform_points(const glm::mat4& transform, float* points, size_t count, size_t stride) {
+			float32x4_t columns[4];
+			load_columns(transform, columns);
+			for (size_t i = 0; i < count; i++) {
+				float* p = points + i * stride;
+				store_vec3(p, transform_point(columns, load_vec3(p)));
+			}
+		}
+		void transform_aabbs(const glm::mat4& transform, const Bounds::AABB* aabbs, Bounds::AABB* out, size_t count) {
+			float32x4_t columns[4];
+			load_columns(transform, columns);
+			const float32x4_t abs_columns[3] = { vabsq_f32(columns[0]), vabsq_f32(columns[1]), vabsq_f32(columns[2]) };
+			for (size_t i = 0; i < count; i++) {
+				const float* box = reinterpret_cast<const float*>(aabbs + i);
+				const float32x4_t min = load_vec3(box);
+				const float32x4_t max = load_vec3(box + 3);
+				const float32x4_t center = transform_point(columns, vmulq_n_f32(vaddq_f32(min, max), 0.5f));
+				const float32x4_t extent = vmulq_n_f32(vsubq_f32(max, min), 0.5f);
+				float32x4_t new_extent = vmulq_laneq_f32(abs_columns[0], extent, 0);
+				new_extent = vaddq_f32(new_extent, vmulq_laneq_f32(abs_columns[1], extent, 1));
+				new_extent = vaddq_f32(new_extent, vmulq_laneq_f32(abs_columns[2], extent, 2));
+				const uint32x4_t is_empty = vdupq_laneq_u32(vcgtq_f32(min, max), 0);
+				float* result = reinterpret_cast<float*>(out + i);
+				store_vec3(result, vbslq_f32(is_empty, min, vsubq_f32(center, new_extent)));
+				store_vec3(result + 3, vbslq_f32(is_empty, max, vaddq_f32(center, new_extent)));
+			}
+		}
+		void cull_spheres(const Bounds::Frustum& planes, const float* spheres, size_t count, size_t stride, uint8_t* outside) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const float32x4x2_t spheres_02 = vzipq_f32(vld1q_f32(spheres + i * stride), vld1q_f32(spheres + (i + 2) * stride));
+				const float32x4x2_t spheres_13 = vzipq_f32(vld1q_f32(spheres + (i + 1) * stride), vld1q_f32(spheres + (i + 3) * stride));
+				const float32x4x2_t xy = vzipq_f32(spheres_02.val[0], spheres_13.val[0]);
+				const float32x4x2_t zr = vzipq_f32(spheres_02.val[1], spheres_13.val[1]);
+				const float32x4_t negative_radius = vnegq_f32(zr.val[1]);
+				uint32x4_t is_outside = vdupq_n_u32(0);
+				for (const auto& plane : planes) {
+					float32x4_t distance = vmulq_n_f32(xy.val[0], plane.x);
+					distance = vaddq_f32(distance, vmulq_n_f32(xy.val[1], plane.y));
+					distance = vaddq_f32(distance, vmulq_n_f32(zr.val[0], plane.z));
+					distance = vaddq_f32(distance, vdupq_n_f32(plane.w));
+					is_outside = vorrq_u32(is_outside, vcltq_f32(distance, negative_radius));
+				}
+				outside[i] = vgetq_lane_u32(is_outside, 0) != 0;
+				outside[i + 1] = vgetq_lane_u32(is_outside, 1) != 0;
+				outside[i + 2] = vgetq_lane_u32(is_outside, 2) != 0;
+				outside[i + 3] = vgetq_lane_u32(is_outside, 3) != 0;
+			}
+			Scalar::cull_spheres(planes, spheres + i * stride, count - i, stride, outside + i);
+		}
+		void convert_ai_matrices(const aiMatrix4x4* matrices, glm::mat4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				// the interleaved load splits the rows into columns
+				const float32x4x4_t columns = vld4q_f32(reinterpret_cast<const float*>(matrices + i));
+				float* result = reinterpret_cast<float*>(out + i);
+				for (int k = 0; k < 4; k++) {
+					vst1q_f32(result + k * 4, columns.val[k]);
+				}
+			}
+		}
+	}
+#endif
+
+	bool is_supported(Level level) {
+		switch (level) {
+		case Level::scalar:
+			return true;
+#if defined(SIMD_KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+		case Level::sse41: {
+			int info[4]{};
+			__cpuid(info, 1);
+			return (info[2] >> 19) & 1;
+		}
+		case Level::avx2: {
+			int info[4]{};
+			__cpuid(info, 1);
+			// the os has to save the ymm registers
+			const bool has_avx_state = ((info[2] >> 27) & 1) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			return has_avx_state && ((info[1] >> 5) & 1);
+		}
+#elif defined(SIMD_KERNELS_X86)
+		case Level::sse41:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("sse4.1");
+		case Level::avx2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#elif defined(SIMD_KERNELS_NEON)
+		case Level::neon:
+			return true;
+#endif
+		default:
+			return false;
+		}
+	}
+	const char* get_level_name(Level level) {
+		switch (level) {
+		case Level::sse41: return "sse4.1";
+		case Level::avx2: return "avx2";
+		case Level::neon: return "neon";
+		default: return "scalar";
+		}
+	}
+	Level detect_level() {
+		for (Level level : { Level::avx2, Level::sse41, Level::neon }) {
+			if (is_supported(level)) {
+				return level;
+			}
+		}
+		return Level::scalar;
+	}
+	// the kernels of one level, which has to be supported
+	const Kernels& get_kernels(Level level) {
+		static const Kernels scalar{ Level::scalar, Scalar::multiply, Scalar::transform_points, Scalar::transform_aabbs, Scalar::cull_spheres, Scalar::convert_ai_matrices };
+#if defined(SIMD_KERNELS_X86)
+		static const Kernels sse41{ Level::sse41, Sse41::multiply, Sse41::transform_points, Sse41::transform_aabbs, Sse41::cull_spheres, Sse41::convert_ai_matrices };
+		static const Kernels avx2{ Level::avx2, Avx2::multiply, Avx2::transform_points, Avx2::transform_aabbs, Avx2::cull_spheres, Avx2::convert_ai_matrices };
+		if (level == Level::sse41) {
+			return sse41;
+		}
+		if (level == Level::avx2) {
+			return avx2;
+		}
+#elif defined(SIMD_KERNELS_NEON)
+		static const Kernels neon{ Level::neon, Neon::multiply, Neon::transform_points, Neon::transform_aabbs, Neon::cull_spheres, Neon::convert_ai_matrices };
+		if (level == Level::neon) {
+			return neon;
+		}
+#endif
+		return scalar;
+	}
+	// the best supported kernels, detected on first use
+	const Kernels& get_kernels() {
+		static const Kernels& kernels = get_kernels(detect_level());
+		return kernels;
+	}
+
+	void multiply(const glm::mat4* a, const glm::mat4& b, glm::mat4* out, size_t count) {
+		get_kernels().multiply(a, b, out, count);
+	}
+	void transform_points(const glm::mat4& transform, float* points, size_t count, size_t stride) {
+		get_kernels().transform_points(transform, points, count, stride);
+	}
+	void transform_aabbs(const glm::mat4& transform, const Bounds::AABB* aabbs, Bounds::AABB* out, size_t count) {
+		get_kernels().transform_aabbs(transform, aabbs, out, count);
+	}
+	void cull_spheres(const Bounds::Frustum& planes, const float* spheres, size_t count, size_t stride, uint8_t* outside) {
+		get_kernels().cull_spheres(planes, spheres, count, stride, outside);
+	}
+	void convert_ai_matrices(const aiMatrix4x4* matrices, glm::mat4* out, size_t count) {
+		get_kernels().convert_ai_matrices(matrices, out, count);
+	}
+}
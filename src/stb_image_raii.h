@@ -22,7 +22,18 @@ public:
 		if (!image_data_ptr) {
 			throw std::runtime_error("no image file exists at specified filepath" );
 		}
-		size_t image_data_size = width * height;
+		size_t image_data_size = (size_t)width * (size_t)height * (size_t)num_channels;
+		image_data = std::span<stbi_uc>{ image_data_ptr, image_data_size };
+	}
+
+	// decodes an image file that was already read into memory
+	// throws std::runtime_error
+	STBImageRAII(const std::span<const unsigned char> file_data) {
+		stbi_uc* image_data_ptr = stbi_load_from_memory(file_data.data(), (int)file_data.size(), &width, &height, &num_channels, 0);
+		if (!image_data_ptr) {
+			throw std::runtime_error("image file data could not be decoded");
+		}
+		size_t image_data_size = (size_t)width * (size_t)height * (size_t)num_channels;
 		image_data = std::span<stbi_uc>{ image_data_ptr, image_data_size };
 	}
 
@@ -47,9 +47,11 @@ namespace TextureBuilder {
 	enum class TextureLoaderError {
 		texture_file_doesnt_exist
 	};
-	tl::expected<std::unique_ptr<GL3D::Texture>, TextureLoaderError> build(const std::filesystem::path path) {
+	size_t get_image_size_in_bytes(const STBImageRAII& stb_texture) {
+		return (size_t)stb_texture.width * (size_t)stb_texture.height * (size_t)stb_texture.num_channels;
+	}
+	tl::expected<std::unique_ptr<GL3D::Texture>, TextureLoaderError> build(const STBImageRAII& stb_texture) {
 		try {
-			STBImageRAII stb_texture{ path };
 			GL3D::TextureSpec texture_spec{};
 			texture_spec.texture_format = get_texture_format(stb_texture.num_channels).value();
 			texture_spec.internal_texture_format = get_internal_texture_format(stb_texture.num_channels).value();
@@ -61,5 +63,15 @@ namespace TextureBuilder {
 			return tl::unexpected(TextureLoaderError::texture_file_doesnt_exist);
 		}
 	}
+	tl::expected<std::unique_ptr<GL3D::Texture>, TextureLoaderError> build(const std::filesystem::path path) {
+		try {
+			STBImageRAII stb_texture{ path };
+			return build(stb_texture);
+		}
+		catch (const std::exception&)
+		{
+			return tl::unexpected(TextureLoaderError::texture_file_doesnt_exist);
+		}
+	}
 
 }
\ No newline at end of file
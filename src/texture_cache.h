@@ -0,0 +1,286 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <optional>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+
+#include <GL3D/texture.h>
+
+#include "texture_builder.h"
+#include "utils.h"
+
+namespace TextureCache {
+
+	struct Stats {
+		size_t hits{};
+		size_t misses{};
+		size_t content_hits{}; // misses by path that resolved to an already resident texture with identical file bytes
+		size_t textures_resident{};
+		size_t bytes_resident{}; // size of the decoded image data of every texture still alive
+	};
+
+	// a texture whose file bytes were identical to an already loaded texture under a different path
+	struct Duplicate {
+		std::string path{};
+		std::string original_path{};
+	};
+
+	// result of the cpu half of a cache lookup. either the texture is already resident or the image is decoded
+	// and waits for Cache::resolve to upload it on the thread owning the gl context
+	struct PendingTexture {
+		std::string key{};
+		std::shared_ptr<GL3D::Texture> texture{};
+		// shared by all loads of the same content that were in flight together, the image is decoded once
+		std::shared_ptr<const STBImageRAII> image{};
+		std::optional<uint64_t> content_hash{}; // none when the hash collided with different bytes
+		size_t file_size{};
+	};
+
+	// process-wide cache of uploaded textures keyed by canonical filesystem path and by a hash of the file bytes.
+	// the cache only holds weak references, the texture is freed as soon as the last material drops it
+	class Cache {
+	private:
+		using DecodedImage = std::shared_ptr<const STBImageRAII>;
+		struct ContentEntry {
+			std::weak_ptr<GL3D::Texture> texture{};
+			std::string path{};
+			size_t file_size{};
+			std::weak_ptr<const STBImageRAII> image{}; // the decode the texture was uploaded from
+		};
+		// content that is being decoded. loads of the same content wait for it instead of decoding it again
+		struct DecodingEntry {
+			std::shared_future<DecodedImage> image{};
+			std::string path{};
+			size_t file_size{};
+		};
+		struct State {
+			std::mutex mutex{};
+			std::unordered_map<std::string, std::weak_ptr<GL3D::Texture>> textures{};
+			std::unordered_map<uint64_t, ContentEntry> textures_by_content{};
+			std::unordered_map<uint64_t, DecodingEntry> decoding{};
+			std::vector<Duplicate> duplicates{};
+			Stats stats{};
+		};
+		// the deleters of handed out textures keep the state alive, so textures may outlive the cache
+		std::shared_ptr<State> state = std::make_shared<State>();
+
+	public:
+		// reads, hashes and decodes the texture unless it's already resident. doesn't touch gl, safe to call from worker threads
+		PendingTexture load(const std::filesystem::path& path) {
+			const std::string key = get_key(path);
+			{
+				std::lock_guard lock{ state->mutex };
+				auto it = state->textures.find(key);
+				if (it != state->textures.end()) {
+					if (auto texture = it->second.lock()) {
+						state->stats.hits++;
+						return PendingTexture{ key, texture };
+					}
+					state->textures.erase(it);
+				}
+				state->stats.misses++;
+			}
+			auto file_data = GLUtils::read_bytes_from_filepath(path);
+			if (!file_data.has_value()) {
+				return PendingTexture{ key };
+			}
+			const std::span<const unsigned char> bytes = file_data.value();
+			// identical bytes under another name resolve to the texture that is already resident, or wait for the
+			// load that is decoding them
+			const uint64_t content_hash = GLUtils::hash_bytes(bytes);
+			// only weak references on this thread. the last strong one runs the gl delete, which has to happen on the
+			// thread owning the context, so a found texture is handed back in the PendingTexture and released there
+			std::optional<ContentEntry> resident{};
+			std::optional<DecodingEntry> decoding{};
+			std::promise<DecodedImage> decoded{};
+			bool is_decoder = false;
+			{
+				std::lock_guard lock{ state->mutex };
+				auto resident_it = state->textures_by_content.find(content_hash);
+				auto decoding_it = state->decoding.find(content_hash);
+				if (resident_it != state->textures_by_content.end() && !resident_it->second.texture.expired()) {
+					resident = resident_it->second;
+				}
+				else if (decoding_it != state->decoding.end()) {
+					decoding = decoding_it->second;
+				}
+				else {
+					state->decoding[content_hash] = DecodingEntry{ decoded.get_future().share(), key, bytes.size() };
+					is_decoder = true;
+				}
+			}
+			// a hash match only counts once the bytes compared equal, colliding content is decoded on its own
+			if (resident && is_same_content(key, resident->path, resident->file_size, bytes)) {
+				std::lock_guard lock{ state->mutex };
+				if (auto texture = resident->texture.lock()) {
+					record_content_hit(key, resident->path);
+					state->textures[key] = texture;
+					return PendingTexture{ key, std::move(texture) };
+				}
+				// freed while the bytes were compared, decoded again below without taking over the content entry
+			}
+			if (decoding && is_same_content(key, decoding->path, decoding->file_size, bytes)) {
+				DecodedImage image = decoding->image.get();
+				if (!image) {
+					return PendingTexture{ key };
+				}
+				std::lock_guard lock{ state->mutex };
+				record_content_hit(key, decoding->path);
+				return PendingTexture{ key, nullptr, std::move(image), content_hash, bytes.size() };
+			}
+			DecodedImage image = decode(bytes);
+			if (is_decoder) {
+				decoded.set_value(image);
+				if (!image) {
+					std::lock_guard lock{ state->mutex };
+					state->decoding.erase(content_hash);
+				}
+			}
+			if (!image) {
+				return PendingTexture{ key };
+			}
+			return PendingTexture{ key, nullptr, std::move(image), is_decoder ? std::optional<uint64_t>(content_hash) : std::nullopt, bytes.size() };
+		}
+
+		// uploads a pending texture. must be called on the thread owning the gl context
+		std::shared_ptr<GL3D::Texture> resolve(PendingTexture pending) {
+			if (pending.texture || !pending.image) {
+				return pending.texture;
+			}
+			std::lock_guard lock{ state->mutex };
+			prune_expired();
+			std::shared_ptr<GL3D::Texture> texture{};
+			if (pending.content_hash) {
+				// the loads that shared one decode also share the upload, the first one to get here does it
+				const uint64_t content_hash = *pending.content_hash;
+				auto content_it = state->textures_by_content.find(content_hash);
+				if (content_it != state->textures_by_content.end() && is_same_image(content_it->second.image, pending.image)) {
+					texture = content_it->second.texture.lock();
+				}
+				if (!texture) {
+					texture = build_shared(*pending.image);
+					if (texture && content_it == state->textures_by_content.end()) {
+						state->textures_by_content[content_hash] = ContentEntry{ texture, pending.key, pending.file_size, pending.image };
+					}
+				}
+				auto decoding_it = state->decoding.find(content_hash);
+				if (decoding_it != state->decoding.end() && is_same_image(decoding_it->second.image.get(), pending.image)) {
+					state->decoding.erase(decoding_it);
+				}
+			}
+			else {
+				texture = build_shared(*pending.image);
+			}
+			if (texture) {
+				state->textures[pending.key] = texture;
+			}
+			return texture;
+		}
+
+		std::shared_ptr<GL3D::Texture> get_or_build(const std::filesystem::path& path) {
+			return resolve(load(path));
+		}
+
+		Stats get_stats() const {
+			std::lock_guard lock{ state->mutex };
+			return state->stats;
+		}
+
+		std::vector<Duplicate> get_duplicates() const {
+			std::lock_guard lock{ state->mutex };
+			return state->duplicates;
+		}
+
+		void print_report(std::ostream& out = std::cout) const {
+			std::lock_guard lock{ state->mutex };
+			const auto& stats = state->stats;
+			out << "texture cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.content_hits << " identical content, "
+				<< stats.textures_resident << " textures resident (" << stats.bytes_resident / 1024 << " KiB)\n";
+			for (const auto& duplicate : state->duplicates) {
+				out << "  duplicate texture: " << duplicate.path << " has the same content as " << duplicate.original_path << "\n";
+			}
+		}
+
+	private:
+		static std::string get_key(const std::filesystem::path& path) {
+			std::error_code err{};
+			auto canonical_path = std::filesystem::weakly_canonical(path, err);
+			if (err) {
+				return path.lexically_normal().string();
+			}
+			return canonical_path.string();
+		}
+
+		// drops the entries of freed textures so the maps don't grow with every scene that was ever loaded.
+		// must be called with the state mutex held
+		void prune_expired() {
+			std::erase_if(state->textures, [](const auto& entry) { return entry.second.expired(); });
+			std::erase_if(state->textures_by_content, [](const auto& entry) { return entry.second.texture.expired(); });
+		}
+
+		static DecodedImage decode(std::span<const unsigned char> bytes) {
+			try {
+				return std::make_shared<const STBImageRAII>(bytes);
+			}
+			catch (const std::exception&) {
+				return nullptr;
+			}
+		}
+
+		// the same path read twice is taken as the same content, other paths are read again and compared
+		static bool is_same_content(const std::string& key, const std::string& path, size_t file_size, std::span<const unsigned char> bytes) {
+			if (path == key) {
+				return true;
+			}
+			if (file_size != bytes.size()) {
+				return false;
+			}
+			auto file_data = GLUtils::read_bytes_from_filepath(path);
+			return file_data.has_value() && std::equal(bytes.begin(), bytes.end(), file_data.value().begin(), file_data.value().end());
+		}
+
+		// compares the owners, a freed image's address may be reused by a later decode
+		static bool is_same_image(const std::weak_ptr<const STBImageRAII>& lhs, const DecodedImage& rhs) {
+			return !lhs.owner_before(rhs) && !rhs.owner_before(lhs);
+		}
+
+		// must be called with the state mutex held
+		void record_content_hit(const std::string& key, const std::string& original_path) {
+			if (key != original_path) {
+				state->stats.content_hits++;
+				state->duplicates.push_back(Duplicate{ key, original_path });
+			}
+		}
+
+		// must be called with the state mutex held
+		std::shared_ptr<GL3D::Texture> build_shared(const STBImageRAII& stb_texture) {
+			auto texture = TextureBuilder::build(stb_texture).value_or(nullptr);
+			if (!texture) {
+				return nullptr;
+			}
+			const size_t texture_size = TextureBuilder::get_image_size_in_bytes(stb_texture);
+			state->stats.textures_resident++;
+			state->stats.bytes_resident += texture_size;
+			return std::shared_ptr<GL3D::Texture>(texture.release(), [state = state, texture_size](GL3D::Texture* texture) {
+				{
+					std::lock_guard lock{ state->mutex };
+					state->stats.textures_resident--;
+					state->stats.bytes_resident -= texture_size;
+				}
+				delete texture;
+			});
+		}
+	};
+
+	Cache& get() {
+		static Cache cache{};
+		return cache;
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+// fixed set of worker threads used for cpu side work that doesn't touch the gl context
+class ThreadPool {
+private:
+	std::vector<std::thread> workers{};
+	std::deque<std::function<void()>> tasks{};
+	std::mutex mutex{};
+	std::condition_variable task_available{};
+	bool stopping = false;
+
+public:
+	explicit ThreadPool(size_t num_threads = std::max(1u, std::thread::hardware_concurrency())) {
+		for (size_t i = 0; i < num_threads; i++) {
+			workers.emplace_back([this]() { worker_loop(); });
+		}
+	}
+
+	ThreadPool(const ThreadPool& rhs) = delete;
+
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard lock{ mutex };
+			stopping = true;
+		}
+		task_available.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	size_t get_num_threads() const {
+		return workers.size();
+	}
+
+	void submit(std::function<void()> task) {
+		{
+			std::lock_guard lock{ mutex };
+			tasks.push_back(std::move(task));
+		}
+		task_available.notify_one();
+	}
+
+	// calls fn(i) for every i in [0, count) and blocks until all calls returned.
+	// the calling thread takes part in the work, so nesting parallel_for inside a task can't deadlock.
+	// the first exception thrown by fn is rethrown on the calling thread
+	template<typename F>
+	void parallel_for(size_t count, F&& fn) {
+		if (count == 0) {
+			return;
+		}
+		struct Batch {
+			std::atomic<size_t> next_index{};
+			std::atomic<size_t> num_done{};
+			std::mutex mutex{};
+			std::condition_variable finished{};
+			std::exception_ptr exception{};
+		};
+		auto batch = std::make_shared<Batch>();
+		auto run = [batch, count, &fn]() {
+			for (size_t i = batch->next_index++; i < count; i = batch->next_index++) {
+				try {
+					fn(i);
+				}
+				catch (...) {
+					std::lock_guard lock{ batch->mutex };
+					if (!batch->exception) {
+						batch->exception = std::current_exception();
+					}
+				}
+				if (++batch->num_done == count) {
+					std::lock_guard lock{ batch->mutex };
+					batch->finished.notify_all();
+				}
+			}
+		};
+		const size_t num_helpers = std::min(count - 1, workers.size());
+		for (size_t i = 0; i < num_helpers; i++) {
+			submit(run);
+		}
+		run();
+		std::unique_lock lock{ batch->mutex };
+		batch->finished.wait(lock, [&]() { return batch->num_done == count; });
+		if (batch->exception) {
+			std::rethrow_exception(batch->exception);
+		}
+	}
+
+	static ThreadPool& get() {
+		static ThreadPool thread_pool{};
+		return thread_pool;
+	}
+
+private:
+	void worker_loop() {
+		while (true) {
+			std::function<void()> task{};
+			{
+				std::unique_lock lock{ mutex };
+				task_available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty()) {
+					return;
+				}
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
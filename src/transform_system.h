@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+
+#include "thread_pool.h"
+
+// splits the levels of the breadth first world matrix update in NodeStorage::update_transforms across the thread pool
+namespace TransformSystem {
+
+	// nodes per task, levels smaller than this run on the calling thread
+	constexpr size_t chunk_size = 512;
+
+	// calls fn(begin, end) on chunks of [first, first + count), in parallel when there is more than one chunk
+	template<typename F>
+	void for_each_chunk(size_t first, size_t count, bool parallel, F&& fn) {
+		const size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+		if (!parallel || num_chunks < 2) {
+			fn(first, first + count);
+			return;
+		}
+		ThreadPool::get().parallel_for(num_chunks, [&](size_t chunk) {
+			const size_t begin = first + chunk * chunk_size;
+			fn(begin, std::min(begin + chunk_size, first + count));
+		});
+	}
+}
@@ -1,8 +1,15 @@
+#pragma once
+
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <optional>
+#include <filesystem>
+#include <span>
 
 namespace GLUtils {
 	std::optional<std::string> read_string_from_filepath(std::filesystem::path filepath) {
@@ -14,4 +21,39 @@ namespace GLUtils {
 		stream << file.rdbuf();
 		return stream.str();
 	}
+	std::optional<std::vector<unsigned char>> read_bytes_from_filepath(std::filesystem::path filepath) {
+		std::ifstream file{ filepath, std::ios::binary | std::ios::ate };
+		if (!file.is_open()) {
+			return std::nullopt;
+		}
+		std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+			return std::nullopt;
+		}
+		return bytes;
+	}
+	// fast non-cryptographic 64 bit hash. consumes 8 bytes per step and finishes with the murmur3 avalanche
+	uint64_t hash_bytes(std::span<const unsigned char> bytes) {
+		constexpr uint64_t prime_1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t prime_2 = 0xC2B2AE3D27D4EB4Full;
+		uint64_t hash = prime_1 ^ (bytes.size() * prime_2);
+		size_t i = 0;
+		for (; i + 8 <= bytes.size(); i += 8) {
+			uint64_t word{};
+			std::memcpy(&word, bytes.data() + i, 8);
+			hash ^= word * prime_2;
+			hash = ((hash << 31) | (hash >> 33)) * prime_1;
+		}
+		for (; i < bytes.size(); i++) {
+			hash ^= bytes[i] * prime_1;
+			hash = ((hash << 11) | (hash >> 53)) * prime_2;
+		}
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+#include <type_traits>
+
+#include <assimp/scene.h>
+
+#include "vertex_stream.h"
+
+namespace MeshBuilder {
+
+	enum class VertexAttribType {
+		none = 0,
+		position,
+		normal,
+		tex_coord
+	};
+	struct VertexAttrib {
+		size_t size{}; // this is the size of one vertex attribute based on the size of float. if an attrib contains 3 floats, the size will be 3
+		VertexAttribType type{};
+	};
+
+	// vertex attributes usable in a VertexLayout. each one knows its size and how to copy itself out of an aiMesh
+	struct Position {
+		static constexpr VertexAttrib attrib{ 3, VertexAttribType::position };
+		static bool is_present(const aiMesh* ai_mesh) { return ai_mesh->mVertices; }
+		static void write(const aiMesh* ai_mesh, size_t i, float* out) {
+			const auto& ai_pos = ai_mesh->mVertices[i];
+			out[0] = ai_pos.x; out[1] = ai_pos.y; out[2] = ai_pos.z;
+		}
+	};
+	struct Normal {
+		static constexpr VertexAttrib attrib{ 3, VertexAttribType::normal };
+		static bool is_present(const aiMesh* ai_mesh) { return ai_mesh->mNormals; }
+		static void write(const aiMesh* ai_mesh, size_t i, float* out) {
+			const auto& ai_normal = ai_mesh->mNormals[i];
+			out[0] = ai_normal.x; out[1] = ai_normal.y; out[2] = ai_normal.z;
+		}
+	};
+	template<unsigned int Channel>
+	struct TexCoord {
+		static constexpr unsigned int channel = Channel;
+		static constexpr VertexAttrib attrib{ 2, VertexAttribType::tex_coord };
+		static bool is_present(const aiMesh* ai_mesh) { return ai_mesh->mTextureCoords[Channel]; }
+		static void write(const aiMesh* ai_mesh, size_t i, float* out) {
+			const auto& ai_tex_coord = ai_mesh->mTextureCoords[Channel][i];
+			out[0] = ai_tex_coord.x; out[1] = ai_tex_coord.y;
+		}
+	};
+	using UV0 = TexCoord<0>;
+	using UV1 = TexCoord<1>;
+
+	constexpr size_t max_vertex_attribs = 4;
+
+	// runtime view of a VertexLayout. points at the layout's static attribute table, so it never allocates
+	struct VertexFormat {
+		std::span<const VertexAttrib> attribs{};
+		size_t num_floats{}; // floats per vertex
+	};
+
+	// interleaved vertex format described at compile time. attribute offsets and the stride are constants,
+	// so convert() compiles to a branch free copy loop specialized for the layout. the common layouts use the
+	// simd kernels from VertexStream instead
+	template<typename... Attribs>
+	struct VertexLayout {
+		static_assert(sizeof...(Attribs) <= max_vertex_attribs);
+		static constexpr size_t num_attribs = sizeof...(Attribs);
+		static constexpr size_t num_floats = (Attribs::attrib.size + ...);
+		static constexpr size_t stride = num_floats * sizeof(float);
+		static constexpr std::array<VertexAttrib, num_attribs> attribs{ Attribs::attrib... };
+
+		static constexpr VertexFormat get_format() {
+			return VertexFormat{ attribs, num_floats };
+		}
+
+		static void write_vertex(const aiMesh* ai_mesh, size_t i, float* out) {
+			((Attribs::write(ai_mesh, i, out), out += Attribs::attrib.size), ...);
+		}
+
+		// out must hold ai_mesh->mNumVertices * num_floats floats
+		static void convert(const aiMesh* ai_mesh, float* out) {
+			const size_t num_vertices = ai_mesh->mNumVertices;
+			if constexpr (std::is_same_v<VertexLayout, VertexLayout<Position, Normal, TexCoord<0>>>) {
+				VertexStream::interleave_position_normal_uv(ai_mesh->mVertices, ai_mesh->mNormals, ai_mesh->mTextureCoords[0], num_vertices, out);
+			}
+			else if constexpr (std::is_same_v<VertexLayout, VertexLayout<Position, Normal>>) {
+				VertexStream::interleave_position_normal(ai_mesh->mVertices, ai_mesh->mNormals, num_vertices, out);
+			}
+			else {
+				for (size_t i = 0; i < num_vertices; i++) {
+					write_vertex(ai_mesh, i, out + i * num_floats);
+				}
+			}
+		}
+	};
+
+	using LayoutP = VertexLayout<Position>;
+	using LayoutPN = VertexLayout<Position, Normal>;
+	using LayoutPU = VertexLayout<Position, UV0>;
+	using LayoutPNU = VertexLayout<Position, Normal, UV0>;
+	using LayoutPUU = VertexLayout<Position, UV0, UV1>;
+	using LayoutPNUU = VertexLayout<Position, Normal, UV0, UV1>;
+
+	// picks the layout matching the attributes of the mesh and calls fn with a value of that layout type.
+	// uv channels are taken in order starting from channel 0, at most 2 of them
+	template<typename F>
+	decltype(auto) visit_vertex_layout(const aiMesh* ai_mesh, F&& fn) {
+		const bool has_normals = Normal::is_present(ai_mesh);
+		const int num_uv_channels = !UV0::is_present(ai_mesh) ? 0 : !UV1::is_present(ai_mesh) ? 1 : 2;
+		switch (num_uv_channels) {
+		case 0:
+			return has_normals ? fn(LayoutPN{}) : fn(LayoutP{});
+		case 1:
+			return has_normals ? fn(LayoutPNU{}) : fn(LayoutPU{});
+		default:
+			return has_normals ? fn(LayoutPNUU{}) : fn(LayoutPUU{});
+		}
+	}
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <span>
+#include <array>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "vertex_layout.h"
+#include "gpu_mesh.h"
+
+// compact vertex format: positions as 4 x snorm16 inside the mesh bounds, normals as 2 x snorm16 octahedral
+// encodings and uvs as 2 x half floats. 16 bytes per vertex for position/normal/uv instead of 32.
+// the position w component is stored as 0, pbr_vertex.glsl uses that to tell the compact format apart from float
+// positions, which get the default w of 1
+namespace VertexQuantization {
+
+	int16_t float_to_snorm16(float v) {
+		return (int16_t)std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f);
+	}
+	float snorm16_to_float(int16_t v) {
+		return std::max((float)v / 32767.0f, -1.0f);
+	}
+
+	// round to nearest even, overflow goes to infinity and values below the half range to subnormals or zero
+	uint16_t float_to_half(float v) {
+		uint32_t bits{};
+		std::memcpy(&bits, &v, sizeof(bits));
+		const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+		const uint32_t abs_bits = bits & 0x7FFFFFFF;
+		if (abs_bits >= 0x7F800000) {
+			return sign | (abs_bits > 0x7F800000 ? 0x7E00 : 0x7C00); // nan or infinity
+		}
+		if (abs_bits >= 0x477FF000) {
+			return sign | 0x7C00; // rounds past the largest half
+		}
+		if (abs_bits < 0x38800000) {
+			// subnormal half: align the mantissa with the implicit bit to 2^-24 units
+			if (abs_bits < 0x33000000) {
+				return sign;
+			}
+			const uint32_t exponent = abs_bits >> 23;
+			const uint32_t mantissa = (abs_bits & 0x007FFFFF) | 0x00800000;
+			const uint32_t shift = 126 - exponent;
+			uint32_t half_mantissa = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) {
+				half_mantissa++;
+			}
+			return sign | (uint16_t)half_mantissa;
+		}
+		uint32_t rebiased = abs_bits - ((127 - 15) << 23);
+		uint32_t half_bits = rebiased >> 13;
+		const uint32_t remainder = rebiased & 0x1FFF;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half_bits & 1))) {
+			half_bits++;
+		}
+		return sign | (uint16_t)half_bits;
+	}
+	float half_to_float(uint16_t h) {
+		const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+		const uint32_t exponent = (h >> 10) & 0x1F;
+		const uint32_t mantissa = h & 0x3FF;
+		float magnitude{};
+		if (exponent == 0) {
+			magnitude = std::ldexp((float)mantissa, -24);
+		}
+		else if (exponent == 31) {
+			magnitude = mantissa ? std::nanf("") : INFINITY;
+		}
+		else {
+			magnitude = std::ldexp((float)(mantissa | 0x400), (int)exponent - 25);
+		}
+		uint32_t bits{};
+		std::memcpy(&bits, &magnitude, sizeof(bits));
+		bits |= sign;
+		float result{};
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	// maps the unit sphere onto the [-1, 1] square, the lower hemisphere is folded over the diagonals
+	glm::vec2 oct_encode(glm::vec3 n) {
+		n = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+		glm::vec2 e(n.x, n.y);
+		if (n.z < 0.0f) {
+			e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		return e;
+	}
+	// same as oct_decode in pbr_vertex.glsl
+	glm::vec3 oct_decode(glm::vec2 e) {
+		glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+		const float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	// largest round trip errors, measured on the cpu against the float vertices
+	struct QuantizationError {
+		float max_position_error{}; // in mesh units
+		float max_normal_error_degrees{};
+		float max_uv_error{};
+		bool within_bounds = true; // every value is within the rounding error its encoding allows
+	};
+
+	struct QuantizedVertices {
+		std::vector<unsigned char> bytes{};
+		GLRenderer::GpuVertexFormat format{};
+		glm::mat4 dequantization{ 1.0f }; // maps the snorm16 positions back into mesh space, applied through uMat
+		QuantizationError error{};
+	};
+
+	QuantizedVertices quantize(std::span<const float> vertices, const MeshBuilder::VertexFormat& vertex_format) {
+		constexpr size_t position_size = 4 * sizeof(int16_t);
+		constexpr size_t normal_size = 2 * sizeof(int16_t);
+		constexpr size_t tex_coord_size = 2 * sizeof(uint16_t);
+		constexpr float snorm16_step = 1.0f / 32767.0f;
+
+		QuantizedVertices result{};
+		const size_t num_vertices = vertices.size() / vertex_format.num_floats;
+
+		// per attribute source offsets (in floats) and destination offsets (in bytes)
+		std::array<size_t, MeshBuilder::max_vertex_attribs> src_offsets{};
+		size_t src_offset{};
+		size_t dst_offset{};
+		unsigned int tex_coord_channel{};
+		result.format.num_attribs = vertex_format.attribs.size();
+		for (size_t a = 0; a < vertex_format.attribs.size(); a++) {
+			const auto type = vertex_format.attribs[a].type;
+			src_offsets[a] = src_offset;
+			src_offset += vertex_format.attribs[a].size;
+			const GLuint location = GLRenderer::get_attrib_location(type, tex_coord_channel);
+			switch (type)
+			{
+			case MeshBuilder::VertexAttribType::position:
+				result.format.attribs[a] = GLRenderer::GpuVertexAttrib{ location, 4, GL_SHORT, GL_TRUE, dst_offset };
+				dst_offset += position_size;
+				break;
+			case MeshBuilder::VertexAttribType::normal:
+				result.format.attribs[a] = GLRenderer::GpuVertexAttrib{ location, 2, GL_SHORT, GL_TRUE, dst_offset };
+				dst_offset += normal_size;
+				break;
+			default:
+				result.format.attribs[a] = GLRenderer::GpuVertexAttrib{ location, 2, GL_HALF_FLOAT, GL_FALSE, dst_offset };
+				dst_offset += tex_coord_size;
+				tex_coord_channel++;
+				break;
+			}
+		}
+		result.format.stride = dst_offset;
+		result.bytes.resize(num_vertices * result.format.stride);
+
+		// positions are quantized within the mesh bounds, every axis uses the full snorm16 range
+		glm::vec3 min_corner(std::numeric_limits<float>::max());
+		glm::vec3 max_corner(std::numeric_limits<float>::lowest());
+		for (size_t v = 0; v < num_vertices; v++) {
+			const float* p = &vertices[v * vertex_format.num_floats];
+			min_corner = glm::min(min_corner, glm::vec3(p[0], p[1], p[2]));
+			max_corner = glm::max(max_corner, glm::vec3(p[0], p[1], p[2]));
+		}
+		const glm::vec3 center = num_vertices > 0 ? (min_corner + max_corner) * 0.5f : glm::vec3(0.0f);
+		glm::vec3 half_extent = num_vertices > 0 ? (max_corner - min_corner) * 0.5f : glm::vec3(1.0f);
+		for (int i = 0; i < 3; i++) {
+			half_extent[i] = half_extent[i] > 0.0f ? half_extent[i] : 1.0f;
+		}
+		result.dequantization = glm::scale(glm::translate(glm::mat4(1.0f), center), half_extent);
+
+		auto& error = result.error;
+		const float max_cos_error = std::cos(glm::radians(0.05f));
+		for (size_t v = 0; v < num_vertices; v++) {
+			const float* src = &vertices[v * vertex_format.num_floats];
+			unsigned char* dst = &result.bytes[v * result.format.stride];
+			for (size_t a = 0; a < vertex_format.attribs.size(); a++) {
+				const float* attrib = src + src_offsets[a];
+				unsigned char* out = dst + result.format.attribs[a].offset;
+				switch (vertex_format.attribs[a].type)
+				{
+				case MeshBuilder::VertexAttribType::position: {
+					const int16_t q[4] = {
+						float_to_snorm16((attrib[0] - center.x) / half_extent.x),
+						float_to_snorm16((attrib[1] - center.y) / half_extent.y),
+						float_to_snorm16((attrib[2] - center.z) / half_extent.z),
+						0,
+					};
+					std::memcpy(out, q, sizeof(q));
+					for (int i = 0; i < 3; i++) {
+						const float decoded = center[i] + snorm16_to_float(q[i]) * half_extent[i];
+						const float position_error = std::abs(decoded - attrib[i]);
+						error.max_position_error = std::max(error.max_position_error, position_error);
+						error.within_bounds = error.within_bounds && position_error <= half_extent[i] * snorm16_step;
+					}
+					break;
+				}
+				case MeshBuilder::VertexAttribType::normal: {
+					const glm::vec3 normal(attrib[0], attrib[1], attrib[2]);
+					const float normal_length = glm::length(normal);
+					const glm::vec2 e = normal_length > 0.0f ? oct_encode(normal / normal_length) : glm::vec2(0.0f);
+					const int16_t q[2] = { float_to_snorm16(e.x), float_to_snorm16(e.y) };
+					std::memcpy(out, q, sizeof(q));
+					if (normal_length > 0.0f) {
+						const glm::vec3 decoded = oct_decode(glm::vec2(snorm16_to_float(q[0]), snorm16_to_float(q[1])));
+						const float cos_error = std::clamp(glm::dot(decoded, normal / normal_length), -1.0f, 1.0f);
+						error.max_normal_error_degrees = std::max(error.max_normal_error_degrees, glm::degrees(std::acos(cos_error)));
+						error.within_bounds = error.within_bounds && cos_error >= max_cos_error;
+					}
+					break;
+				}
+				default: {
+					const uint16_t q[2] = { float_to_half(attrib[0]), float_to_half(attrib[1]) };
+					std::memcpy(out, q, sizeof(q));
+					for (int i = 0; i < 2; i++) {
+						const float uv_error = std::abs(half_to_float(q[i]) - attrib[i]);
+						error.max_uv_error = std::max(error.max_uv_error, uv_error);
+						// half floats keep 11 significant bits, below 2^-14 the spacing is a fixed 2^-24
+						error.within_bounds = error.within_bounds && uv_error <= std::max(std::abs(attrib[i]) * std::ldexp(1.0f, -11), std::ldexp(1.0f, -25));
+					}
+					break;
+				}
+				}
+			}
+		}
+		return result;
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstring>
+#include <cstddef>
+
+#include <assimp/scene.h>
+
+#include "simd_kernels.h"
+
+// bulk conversion of assimp's separate attribute arrays into interleaved gpu ready vertices. every function writes
+// num_vertices vertices into out, which has to be preallocated by the caller. the kernels are picked at runtime like
+// the ones in SimdKernels, with the same levels and target attributes
+namespace VertexStream {
+
+	static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "vertex streams expect assimp built with single precision floats");
+
+	struct Kernels {
+		SimdKernels::Level level{};
+		// [px py pz nx ny nz]
+		void (*interleave_position_normal)(const aiVector3D* positions, const aiVector3D* normals, size_t num_vertices, float* out){};
+		// [px py pz nx ny nz u v], 32 bytes per vertex
+		void (*interleave_position_normal_uv)(const aiVector3D* positions, const aiVector3D* normals, const aiVector3D* uvs, size_t num_vertices, float* out){};
+	};
+
+	namespace Scalar {
+		void interleave_position_normal(const aiVector3D* positions, const aiVector3D* normals, size_t num_vertices, float* out) {
+			for (size_t i = 0; i < num_vertices; i++) {
+				float* vertex = out + i * 6;
+				vertex[0] = positions[i].x; vertex[1] = positions[i].y; vertex[2] = positions[i].z;
+				vertex[3] = normals[i].x; vertex[4] = normals[i].y; vertex[5] = normals[i].z;
+			}
+		}
+		void interleave_position_normal_uv(const aiVector3D* positions, const aiVector3D* normals, const aiVector3D* uvs, size_t num_vertices, float* out) {
+			for (size_t i = 0; i < num_vertices; i++) {
+				float* vertex = out + i * 8;
+				vertex[0] = positions[i].x; vertex[1] = positions[i].y; vertex[2] = positions[i].z;
+				vertex[3] = normals[i].x; vertex[4] = normals[i].y; vertex[5] = normals[i].z;
+				vertex[6] = uvs[i].x; vertex[7] = uvs[i].y;
+			}
+		}
+	}
+
+	// the 4 wide loads read one float into the next vertex, so every vector version leaves the last vertex to the
+	// scalar loop
+#if defined(SIMD_KERNELS_X86)
+	namespace Sse41 {
+		SIMD_KERNELS_TARGET_SSE41 void interleave_position_normal(const aiVector3D* positions, const aiVector3D* normals, size_t num_vertices, float* out) {
+			size_t i = 0;
+			for (; i + 1 < num_vertices; i++) {
+				__m128 p = _mm_loadu_ps(&positions[i].x);
+				__m128 n = _mm_loadu_ps(&normals[i].x);
+				__m128 p2_n0 = _mm_shuffle_ps(p, n, _MM_SHUFFLE(0, 0, 2, 2));
+				__m128 lo = _mm_shuffle_ps(p, p2_n0, _MM_SHUFFLE(2, 0, 1, 0)); // px py pz nx
+				float* vertex = out + i * 6;
+				_mm_storeu_ps(vertex, lo);
+				_mm_storel_pi(reinterpret_cast<__m64*>(vertex + 4), _mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 1, 2, 1))); // ny nz
+			}
+			Scalar::interleave_position_normal(positions + i, normals + i, num_vertices - i, out + i * 6);
+		}
+		SIMD_KERNELS_TARGET_SSE41 void interleave_position_normal_uv(const aiVector3D* positions, const aiVector3D* normals, const aiVector3D* uvs, size_t num_vertices, float* out) {
+			size_t i = 0;
+			for (; i + 1 < num_vertices; i++) {
+				__m128 p = _mm_loadu_ps(&positions[i].x);
+				__m128 n = _mm_loadu_ps(&normals[i].x);
+				__m128 t = _mm_loadu_ps(&uvs[i].x);
+				__m128 p2_n0 = _mm_shuffle_ps(p, n, _MM_SHUFFLE(0, 0, 2, 2));
+				__m128 lo = _mm_shuffle_ps(p, p2_n0, _MM_SHUFFLE(2, 0, 1, 0)); // px py pz nx
+				__m128 hi = _mm_shuffle_ps(n, t, _MM_SHUFFLE(1, 0, 2, 1)); // ny nz u v
+				_mm_storeu_ps(out + i * 8, lo);
+				_mm_storeu_ps(out + i * 8 + 4, hi);
+			}
+			Scalar::interleave_position_normal_uv(positions + i, normals + i, uvs + i, num_vertices - i, out + i * 8);
+		}
+	}
+	// 6 float vertices don't fill a ymm register, position and normal only use the sse4.1 version
+	namespace Avx2 {
+		SIMD_KERNELS_TARGET_AVX2 void interleave_position_normal_uv(const aiVector3D* positions, const aiVector3D* normals, const aiVector3D* uvs, size_t num_vertices, float* out) {
+			size_t i = 0;
+			// whole vertex in one register: [p0 p1 p2 n0 n1 n2 t0 t1]
+			const __m256i position_normal_idx = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 0, 0);
+			const __m256i uv_idx = _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 0, 1);
+			for (; i + 1 < num_vertices; i++) {
+				__m256 pn = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&positions[i].x)), _mm_loadu_ps(&normals[i].x), 1);
+				__m256 t = _mm256_castps128_ps256(_mm_loadu_ps(&uvs[i].x));
+				__m256 vertex = _mm256_blend_ps(_mm256_permutevar8x32_ps(pn, position_normal_idx), _mm256_permutevar8x32_ps(t, uv_idx), 0xC0);
+				_mm256_storeu_ps(out + i * 8, vertex);
+			}
+			Scalar::interleave_position_normal_uv(positions + i, normals + i, uvs + i, num_vertices - i, out + i * 8);
+		}
+	}
+#endif
+
+#if defined(SIMD_KERNELS_NEON)
+	namespace Neon {
+		void interleave_position_normal(const aiVector3D* positions, const aiVector3D* normals, size_t num_vertices, float* out) {
+			size_t i = 0;
+			for (; i + 1 < num_vertices; i++) {
+				const float32x4_t p = vld1q_f32(&positions[i].x);
+				const float32x4_t n = vld1q_f32(&normals[i].x);
+				float* vertex = out + i * 6;
+				vst1q_f32(vertex, vcopyq_laneq_f32(p, 3, n, 0)); // px py pz nx
+				vst1_f32(vertex + 4, vget_low_f32(vextq_f32(n, n, 1))); // ny nz
+			}
+			Scalar::interleave_position_normal(positions + i, normals + i, num_vertices - i, out + i * 6);
+		}
+		void interleave_position_normal_uv(const aiVector3D* positions, const aiVector3D* normals, const aiVector3D* uvs, size_t num_vertices, float* out) {
+			size_t i = 0;
+			for (; i + 1 < num_vertices; i++) {
+				const float32x4_t p = vld1q_f32(&positions[i].x);
+				const float32x4_t n = vld1q_f32(&normals[i].x);
+				float* vertex = out + i * 8;
+				vst1q_f32(vertex, vcopyq_laneq_f32(p, 3, n, 0)); // px py pz nx
+				vst1q_f32(vertex + 4, vcombine_f32(vget_low_f32(vextq_f32(n, n, 1)), vld1_f32(&uvs[i].x))); // ny nz u v
+			}
+			Scalar::interleave_position_normal_uv(positions + i, normals + i, uvs + i, num_vertices - i, out + i * 8);
+		}
+	}
+#endif
+
+	// the kernels of one level, which has to be supported
+	const Kernels& get_kernels(SimdKernels::Level level) {
+		static const Kernels scalar{ SimdKernels::Level::scalar, Scalar::interleave_position_normal, Scalar::interleave_position_normal_uv };
+#if defined(SIMD_KERNELS_X86)
+		static const Kernels sse41{ SimdKernels::Level::sse41, Sse41::interleave_position_normal, Sse41::interleave_position_normal_uv };
+		static const Kernels avx2{ SimdKernels::Level::avx2, Sse41::interleave_position_normal, Avx2::interleave_position_normal_uv };
+		if (level == SimdKernels::Level::sse41) {
+			return sse41;
+		}
+		if (level == SimdKernels::Level::avx2) {
+			return avx2;
+		}
+#elif defined(SIMD_KERNELS_NEON)
+		static const Kernels neon{ SimdKernels::Level::neon, Neon::interleave_position_normal, Neon::interleave_position_normal_uv };
+		if (level == SimdKernels::Level::neon) {
+			return neon;
+		}
+#endif
+		return scalar;
+	}
+	// the best supported kernels, detected on first use
+	const Kernels& get_kernels() {
+		static const Kernels& kernels = VertexStream::get_kernels(SimdKernels::detect_level());
+		return kernels;
+	}
+	const char* get_kernel_name() {
+		return SimdKernels::get_level_name(get_kernels().level);
+	}
+
+	void interleave_position_normal(const aiVector3D* positions, const aiVector3D* normals, size_t num_vertices, float* out) {
+		get_kernels().interleave_position_normal(positions, normals, num_vertices, out);
+	}
+	void interleave_position_normal_uv(const aiVector3D* positions, const aiVector3D* normals, const aiVector3D* uvs, size_t num_vertices, float* out) {
+		get_kernels().interleave_position_normal_uv(positions, normals, uvs, num_vertices, out);
+	}
+}